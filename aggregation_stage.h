@@ -0,0 +1,239 @@
+#ifndef _AGGREGATION_STAGE_H_
+#define _AGGREGATION_STAGE_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <cassert>
+#include "measurement.h"
+
+/*
+    Optional per-sensor stage between the frame parser and the global queue.
+
+    Fast sensors that report slow-moving signals do not need every frame downstream,
+    but every frame costs a queue slot and a consumer wake-up. The stage reduces the stream:
+
+    KEEP_EVERY_NTH : forward 1 frame out of N
+    WINDOW         : fold all frames of a time window into one measurement, per sample index:
+                     min / max / mean / last
+    suppress_unchanged (any mode) : drop an output whose payload equals the previous emitted one
+
+    Payload is decoded as an array of little-endian signed samples of sample_width bytes
+    (1, 2 or 4), trailing bytes that do not form a whole sample are ignored.
+    Aggregates are encoded back in the same format.
+
+    A window is closed by the first frame that falls outside it (or that has a different
+    sample count), so a sensor that goes silent keeps its last window open until the next frame.
+
+    Usage (single thread, the sensor worker):
+        if (!stage.has_output()) stage.feed(frame);
+        if (stage.has_output()) { push(stage.peek_output()); stage.pop_output(); }
+*/
+
+enum class aggregation_mode { NONE, KEEP_EVERY_NTH, WINDOW };
+enum class window_function { MIN, MAX, MEAN, LAST };
+
+struct aggregation_config {
+    aggregation_mode mode = aggregation_mode::NONE;
+    size_t keep_every_nth = 1;
+    std::chrono::milliseconds window{0};
+    window_function func = window_function::LAST;
+    size_t sample_width = 2; //bytes
+    bool suppress_unchanged = false;
+
+    bool enabled() const {
+        return mode != aggregation_mode::NONE || suppress_unchanged;
+    }
+};
+
+class aggregation_stage
+{
+private:
+    aggregation_config conf;
+    size_t frames_in;
+    size_t frames_out;
+    size_t suppressed;
+    size_t nth_counter;
+
+    //current window
+    bool window_open;
+    std::chrono::steady_clock::time_point window_start;
+    size_t window_frames;
+    std::vector<int64_t> acc; //min / max / sum / last per sample index, depending on func
+    measurement window_last; //metadata source for the aggregate (newest frame of the window)
+
+    bool output_ready;
+    measurement output;
+    std::vector<uint8_t> last_emitted;
+    bool has_last_emitted;
+
+    int64_t decode_sample(const uint8_t *p) const {
+        switch (conf.sample_width) {
+            case 1:
+                return static_cast<int8_t>(p[0]);
+            case 2:
+                return static_cast<int16_t>(static_cast<uint16_t>(p[0] | (p[1] << 8)));
+            default:
+                return static_cast<int32_t>(static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+                                            (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24));
+        }
+    }
+
+    void encode_sample(int64_t v, uint8_t *p) const {
+        //saturate to the sample range, mean of in-range values is always in range
+        int64_t max_v = (int64_t(1) << (conf.sample_width * 8 - 1)) - 1;
+        int64_t min_v = -max_v - 1;
+        uint32_t u = static_cast<uint32_t>(std::clamp(v, min_v, max_v));
+        for (size_t i = 0; i < conf.sample_width; i++) {
+            p[i] = static_cast<uint8_t>(u >> (8 * i));
+        }
+    }
+
+    size_t sample_count(const measurement &m) const {
+        return m.payload.size() / conf.sample_width;
+    }
+
+    void open_window(const measurement &m) {
+        size_t n = sample_count(m);
+        window_open = true;
+        window_start = m.system_timestamp;
+        window_frames = 0;
+        acc.assign(n, 0);
+        if (conf.func == window_function::MIN) {
+            std::fill(acc.begin(), acc.end(), std::numeric_limits<int64_t>::max());
+        }
+        else if (conf.func == window_function::MAX) {
+            std::fill(acc.begin(), acc.end(), std::numeric_limits<int64_t>::min());
+        }
+    }
+
+    void fold(const measurement &m) {
+        const uint8_t *p = m.payload.data();
+        for (size_t i = 0; i < acc.size(); i++, p += conf.sample_width) {
+            int64_t v = decode_sample(p);
+            switch (conf.func) {
+                case window_function::MIN:
+                    acc[i] = std::min(acc[i], v);
+                    break;
+                case window_function::MAX:
+                    acc[i] = std::max(acc[i], v);
+                    break;
+                case window_function::MEAN:
+                    acc[i] += v;
+                    break;
+                case window_function::LAST:
+                    acc[i] = v;
+                    break;
+            }
+        }
+        window_frames++;
+        window_last.system_timestamp = m.system_timestamp;
+        window_last.sensor_id = m.sensor_id;
+        window_last.sequence_number = m.sequence_number;
+    }
+
+    void close_window() {
+        measurement m;
+        m.system_timestamp = window_last.system_timestamp;
+        m.sensor_id = window_last.sensor_id;
+        m.sequence_number = window_last.sequence_number;
+        m.payload.resize(acc.size() * conf.sample_width);
+
+        uint8_t *p = m.payload.data();
+        for (size_t i = 0; i < acc.size(); i++, p += conf.sample_width) {
+            int64_t v = acc[i];
+            if (conf.func == window_function::MEAN) {
+                v = v / static_cast<int64_t>(window_frames);
+            }
+            encode_sample(v, p);
+        }
+        window_open = false;
+        emit(std::move(m));
+    }
+
+    void emit(measurement m) {
+        if (conf.suppress_unchanged) {
+            if (has_last_emitted && m.payload == last_emitted) {
+                suppressed++;
+                return;
+            }
+            last_emitted = m.payload;
+            has_last_emitted = true;
+        }
+        output = std::move(m);
+        output_ready = true;
+        frames_out++;
+    }
+
+public:
+    aggregation_stage(const aggregation_config &config) : conf(config), frames_in(0), frames_out(0), suppressed(0), nth_counter(0), window_open(false), window_frames(0), output_ready(false), has_last_emitted(false) {
+
+        if (conf.sample_width != 1 && conf.sample_width != 2 && conf.sample_width != 4) {
+            throw std::invalid_argument("illegal sample width");
+        }
+        if (conf.mode == aggregation_mode::KEEP_EVERY_NTH && conf.keep_every_nth == 0) {
+            throw std::invalid_argument("illegal decimation factor");
+        }
+        if (conf.mode == aggregation_mode::WINDOW && conf.window.count() <= 0) {
+            throw std::invalid_argument("illegal aggregation window");
+        }
+    }
+
+    // frame must carry its timestamp, caller must not feed while has_output()
+    void feed(const measurement &frame) {
+        assert(!has_output());
+        frames_in++;
+
+        switch (conf.mode) {
+            case aggregation_mode::NONE:
+                emit(frame);
+                break;
+
+            case aggregation_mode::KEEP_EVERY_NTH:
+                if (nth_counter++ % conf.keep_every_nth == 0) {
+                    emit(frame);
+                }
+                break;
+
+            case aggregation_mode::WINDOW:
+                if (window_open && (frame.system_timestamp - window_start >= conf.window || sample_count(frame) != acc.size())) {
+                    close_window();
+                }
+                if (!window_open) {
+                    open_window(frame);
+                }
+                fold(frame);
+                break;
+        }
+    }
+
+    bool has_output() const { return output_ready; }
+
+    const measurement& peek_output() const {
+        assert(has_output());
+        return output;
+    }
+
+    void pop_output() {
+        assert(has_output());
+        output_ready = false;
+    }
+
+    size_t get_frames_in() const { return frames_in; }
+    size_t get_frames_out() const { return frames_out; }
+    size_t get_suppressed_count() const { return suppressed; }
+
+    // frames in per measurement out (1.0 = no reduction)
+    double reduction_ratio() const {
+        if (frames_out == 0) {
+            return frames_in == 0 ? 1.0 : static_cast<double>(frames_in);
+        }
+        return static_cast<double>(frames_in) / static_cast<double>(frames_out);
+    }
+};
+
+#endif
@@ -0,0 +1,175 @@
+/*
+    Fan-out of every measurement to three consumers: broadcast_ring vs one copy per consumer.
+
+    Consumers (one thread each):
+        recorder  : required, sums the payload bytes
+        alarms    : required, checks one payload byte against a threshold
+        dashboard : lossy in the broadcast case, slow (busy work per item)
+
+    Modes:
+        copy      : the producer copies each measurement into one spsc_ring per consumer
+                    (what copy + re-enqueue costs today), the dashboard ring drops when full
+        broadcast : one publish() per measurement, every consumer reads the same slot
+
+    Reported per mode and payload size: published items/s, items seen per consumer, dashboard drops.
+
+    Build (from the repository root):
+        g++ -std=c++20 -O2 -I. bench/broadcast_bench.cpp -pthread -o broadcast_bench
+
+    Output: one JSON object per line on stdout (JSON lines).
+
+    Usage: broadcast_bench [items] [ring_capacity]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "measurement.h"
+#include "spsc_ring.h"
+#include "broadcast_ring.h"
+
+static constexpr size_t consumer_count = 3;
+static constexpr size_t dashboard = 2;
+static volatile int dashboard_sink; //keeps the dashboard busy work
+
+struct consumer_result {
+    uint64_t seen = 0;
+    uint64_t checksum = 0;
+};
+
+// per item work of each consumer
+static void visit(size_t consumer, const measurement &m, consumer_result &res) {
+    res.seen++;
+    if (consumer == 0) {
+        for (uint8_t b : m.payload) {
+            res.checksum += b;
+        }
+    }
+    else if (consumer == 1) {
+        res.checksum += (!m.payload.empty() && m.payload[0] > 200) ? 1 : 0;
+    }
+    else {
+        for (int k = 0; k < 400; k++) {
+            dashboard_sink = k;
+        }
+    }
+}
+
+static measurement make_item(uint64_t i, size_t payload_bytes) {
+    measurement m;
+    m.sensor_id = i % 16;
+    m.sequence_number = i;
+    m.system_timestamp = std::chrono::steady_clock::now();
+    m.payload.assign(payload_bytes, static_cast<uint8_t>(i));
+    return m;
+}
+
+static void print_result(const char *mode, size_t payload_bytes, uint64_t items, double sec, const consumer_result *res, uint64_t dashboard_drops) {
+    std::printf("{\"mode\":\"%s\",\"payload_bytes\":%zu,\"items\":%llu,\"items_per_s\":%.0f,"
+                "\"recorder_seen\":%llu,\"alarms_seen\":%llu,\"dashboard_seen\":%llu,\"dashboard_drops\":%llu}\n",
+        mode, payload_bytes, static_cast<unsigned long long>(items), (sec > 0.0) ? static_cast<double>(items) / sec : 0.0,
+        static_cast<unsigned long long>(res[0].seen), static_cast<unsigned long long>(res[1].seen),
+        static_cast<unsigned long long>(res[2].seen), static_cast<unsigned long long>(dashboard_drops));
+    std::fflush(stdout);
+}
+
+static void run_copy(uint64_t items, size_t payload_bytes, size_t capacity) {
+    std::vector<std::unique_ptr<spsc_ring<measurement>>> rings;
+    for (size_t c = 0; c < consumer_count; c++) {
+        rings.push_back(std::make_unique<spsc_ring<measurement>>(capacity));
+    }
+    consumer_result res[consumer_count];
+    uint64_t drops = 0;
+
+    std::vector<std::thread> consumers;
+    for (size_t c = 0; c < consumer_count; c++) {
+        consumers.emplace_back([&, c] {
+            measurement batch[64];
+            while (true) {
+                size_t n = rings[c]->pop_batch(batch, 64);
+                for (size_t i = 0; i < n; i++) {
+                    visit(c, batch[i], res[c]);
+                }
+                if (n == 0) {
+                    if (rings[c]->drained()) {
+                        break;
+                    }
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < items; i++) {
+        measurement m = make_item(i, payload_bytes);
+        for (size_t c = 0; c < consumer_count; c++) {
+            measurement copy = (c + 1 < consumer_count) ? m : std::move(m);
+            if (c == dashboard) {
+                if (!rings[c]->try_push(std::move(copy))) {
+                    drops++;
+                }
+                continue;
+            }
+            while (!rings[c]->try_push(std::move(copy))) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    for (auto &r : rings) {
+        r->close();
+    }
+    for (auto &t : consumers) {
+        t.join();
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    print_result("copy", payload_bytes, items, sec, res, drops);
+}
+
+static void run_broadcast(uint64_t items, size_t payload_bytes, size_t capacity) {
+    broadcast_ring<measurement> ring(capacity, consumer_count);
+    size_t ids[consumer_count];
+    ids[0] = ring.add_consumer(broadcast_consumer::REQUIRED);
+    ids[1] = ring.add_consumer(broadcast_consumer::REQUIRED);
+    ids[2] = ring.add_consumer(broadcast_consumer::LOSSY);
+    consumer_result res[consumer_count];
+
+    std::vector<std::thread> consumers;
+    for (size_t c = 0; c < consumer_count; c++) {
+        consumers.emplace_back([&, c] {
+            while (!ring.drained(ids[c])) {
+                size_t n = ring.consume(ids[c], [&](const measurement &m) { visit(c, m, res[c]); }, (c == dashboard) ? 8 : 64);
+                if (n == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < items; i++) {
+        ring.publish(make_item(i, payload_bytes));
+    }
+    ring.close();
+    for (auto &t : consumers) {
+        t.join();
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    print_result("broadcast", payload_bytes, items, sec, res, ring.lost(ids[dashboard]));
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t items = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t capacity = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 1024;
+
+    for (size_t payload_bytes : {16, 256, 2048}) {
+        run_copy(items, payload_bytes, capacity);
+        run_broadcast(items, payload_bytes, capacity);
+    }
+    return 0;
+}
@@ -0,0 +1,256 @@
+/*
+    N fake sensors: coroutine workers on a sensor_executor vs one thread per sensor.
+
+    - sensors: pipe backed sources (stand in for ttys), non-blocking, with a stop eventfd
+    - sender: every period writes one SYNC|LEN|PAYLOAD|CRC frame to each sensor in turn,
+      the payload is the steady_clock time of that write
+    - consumer: pops the global queue, wake-to-process latency = measurement.system_timestamp
+      (set by the worker when the frame is parsed) - write time
+
+    Modes:
+        threads  : worker.start(), one blocked reader thread per sensor
+        executor : worker.start(executor) on `loops` epoll loops
+
+    Reported per mode: process RSS after the workers started (rss_kb) and its growth over the
+    baseline with the workers constructed but not started (rss_delta_kb), thread count,
+    latency p50 / p99 / max.
+
+    Build (from the repository root):
+        g++ -std=c++20 -O2 -I. bench/executor_bench.cpp stream_buffer.cpp -pthread -o executor_bench
+
+    Output: one JSON object per line on stdout (JSON lines).
+
+    Usage: executor_bench [sensors] [rounds] [period_ms] [loops]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <bit>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include "unique_fd.h"
+#include "crc8.h"
+#include "measurement.h"
+#include "lockless_global_queue.h"
+#include "uart_frame_parser.h"
+#include "sensor_executor.h"
+#include "sensor_worker.h"
+
+using bench_queue = lockless_global_queue<measurement>;
+
+static constexpr size_t frame_bytes = 2 + sizeof(int64_t) + 1;
+
+// non-blocking pipe read end, read_bytes() polls it with the stop eventfd
+class pipe_source : public sensor_source
+{
+private:
+    unique_fd rfd;
+    unique_fd stopfd;
+
+public:
+    pipe_source(int read_fd) : rfd(read_fd), stopfd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+        fcntl(rfd.get(), F_SETFL, fcntl(rfd.get(), F_GETFL) | O_NONBLOCK);
+    }
+
+    ssize_t read_bytes(uint8_t *buf, size_t buf_len) override {
+        pollfd plfd[2]{};
+        plfd[0].fd = rfd.get();
+        plfd[0].events = POLLIN;
+        plfd[1].fd = stopfd.get();
+        plfd[1].events = POLLIN;
+        while (true) {
+            ssize_t ret = try_read_bytes(buf, buf_len);
+            if (ret != would_block) {
+                return ret;
+            }
+            if (poll(plfd, 2, -1) < 0 && errno != EINTR) {
+                return -1;
+            }
+        }
+    }
+
+    std::vector<int> pollable_fds() const override {
+        return {rfd.get(), stopfd.get()};
+    }
+
+    ssize_t try_read_bytes(uint8_t *buf, size_t buf_len) override {
+        uint64_t v;
+        if (read(stopfd.get(), &v, sizeof(v)) == sizeof(v)) {
+            return 0;
+        }
+        ssize_t ret = read(rfd.get(), buf, buf_len);
+        if (ret < 0) {
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? would_block : -1;
+        }
+        return ret;
+    }
+
+    int stop_request() override {
+        uint64_t one = 1;
+        return (write(stopfd.get(), &one, sizeof(one)) == sizeof(one)) ? 0 : -1;
+    }
+};
+
+struct bench_sensor {
+    int wfd = -1;
+    std::unique_ptr<pipe_source> source;
+    std::unique_ptr<uart_frame_parser> parser;
+    std::unique_ptr<sensor_worker<bench_queue>> worker;
+
+    ~bench_sensor() {
+        worker.reset(); //stops the worker before its source goes away
+        if (wfd >= 0) {
+            close(wfd);
+        }
+    }
+};
+
+// nth_element based, reorders samples
+static uint64_t percentile(std::vector<uint64_t> &samples, double pct) {
+    if (samples.empty()) {
+        return 0;
+    }
+    size_t idx = std::min(samples.size() - 1, static_cast<size_t>(pct * static_cast<double>(samples.size())));
+    std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return samples[idx];
+}
+
+static int64_t to_ns(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+// VmRSS / Threads from /proc/self/status, 0 when not found
+static size_t proc_status(const char *key) {
+    FILE *f = std::fopen("/proc/self/status", "r");
+    if (f == nullptr) {
+        return 0;
+    }
+    char line[256];
+    size_t key_len = std::strlen(key);
+    size_t value = 0;
+    while (std::fgets(line, sizeof(line), f) != nullptr) {
+        if (std::strncmp(line, key, key_len) == 0 && line[key_len] == ':') {
+            value = std::strtoull(line + key_len + 1, nullptr, 10);
+            break;
+        }
+    }
+    std::fclose(f);
+    return value;
+}
+
+static void run_case(bool use_executor, size_t sensors, size_t rounds, std::chrono::milliseconds period, size_t loops) {
+    bench_queue q(std::bit_ceil(std::max<size_t>(1024, sensors * 2)), memory_policy{});
+    std::unique_ptr<sensor_executor> executor;
+    if (use_executor) {
+        executor = std::make_unique<sensor_executor>(loops);
+    }
+
+    std::vector<bench_sensor> bench_sensors(sensors);
+    for (size_t i = 0; i < sensors; i++) {
+        int pfd[2];
+        if (pipe2(pfd, O_CLOEXEC) != 0) {
+            std::fprintf(stderr, "pipe2 failed after %zu sensors: %s\n", i, std::strerror(errno));
+            return;
+        }
+        bench_sensor &s = bench_sensors[i];
+        s.wfd = pfd[1];
+        s.source = std::make_unique<pipe_source>(pfd[0]);
+        s.parser = std::make_unique<uart_frame_parser>();
+        s.worker = std::make_unique<sensor_worker<bench_queue>>(256, i, *s.source, *s.parser, q);
+    }
+
+    size_t rss_base = proc_status("VmRSS");
+    for (auto &s : bench_sensors) {
+        if (use_executor) {
+            s.worker->start(*executor);
+        }
+        else {
+            s.worker->start();
+        }
+    }
+
+    std::vector<uint64_t> latencies;
+    latencies.reserve(sensors * rounds);
+    std::atomic<bool> done{false};
+    std::thread consumer([&] {
+        measurement m;
+        while (latencies.size() < sensors * rounds && !done.load()) {
+            if (q.pop(m) != queue_status::OK) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                continue;
+            }
+            int64_t sent;
+            std::memcpy(&sent, m.payload.data(), sizeof(sent));
+            latencies.push_back(static_cast<uint64_t>(to_ns(m.system_timestamp) - sent));
+        }
+    });
+
+    size_t rss = 0;
+    size_t threads = 0;
+    for (size_t r = 0; r < rounds; r++) {
+        auto round_start = std::chrono::steady_clock::now();
+        for (auto &s : bench_sensors) {
+            uint8_t frame[frame_bytes];
+            int64_t sent = to_ns(std::chrono::steady_clock::now());
+            frame[0] = 0xAA;
+            frame[1] = sizeof(int64_t);
+            std::memcpy(frame + 2, &sent, sizeof(sent));
+            frame[frame_bytes - 1] = crc8::compute(frame + 2, sizeof(int64_t));
+            (void)write(s.wfd, frame, sizeof(frame));
+        }
+        if (r == 0) {
+            //every worker ran once: its read buffer and stack are touched
+            std::this_thread::sleep_for(period / 2);
+            rss = proc_status("VmRSS");
+            threads = proc_status("Threads");
+        }
+        std::this_thread::sleep_until(round_start + period);
+    }
+
+    std::this_thread::sleep_for(period);
+    done.store(true);
+    consumer.join();
+    for (auto &s : bench_sensors) {
+        s.worker->stop();
+    }
+
+    size_t delivered = latencies.size();
+    std::printf("{\"mode\":\"%s\",\"sensors\":%zu,\"loops\":%zu,\"rounds\":%zu,\"delivered\":%zu,\"threads\":%zu,"
+                "\"rss_kb\":%zu,\"rss_delta_kb\":%lld,\"latency_p50_us\":%.1f,\"latency_p99_us\":%.1f,\"latency_max_us\":%.1f}\n",
+        use_executor ? "executor" : "threads", sensors, use_executor ? loops : 0, rounds, delivered, threads,
+        rss, static_cast<long long>(rss) - static_cast<long long>(rss_base),
+        static_cast<double>(percentile(latencies, 0.50)) / 1000.0,
+        static_cast<double>(percentile(latencies, 0.99)) / 1000.0,
+        static_cast<double>(percentile(latencies, 1.0)) / 1000.0);
+    std::fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    size_t sensors = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000;
+    size_t rounds = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 100;
+    std::chrono::milliseconds period((argc > 3) ? std::strtoll(argv[3], nullptr, 10) : 20);
+    size_t loops = (argc > 4) ? std::strtoull(argv[4], nullptr, 10) : 1;
+
+    //3 fds per sensor
+    rlimit lim{};
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max) {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+
+    run_case(false, sensors, rounds, period, loops);
+    run_case(true, sensors, rounds, period, loops);
+    return 0;
+}
@@ -0,0 +1,137 @@
+/*
+    history_store: compression and query latency.
+
+    Synthetic sensors sampled at 1 kHz with 1% timestamp jitter, payload = 4 little-endian int16 channels:
+        constant : same value every sample
+        slow     : ramp changing every 10 samples
+        noisy    : slow ramp + random low byte on every channel
+    60 s of data is ingested for every sensor, then queries run on the last minute.
+
+    Reported per payload shape:
+        ingest_ns_per_sample   append() cost
+        bytes_per_sample       encoded bytes / stored samples (raw measurement: 8 payload + 24 metadata bytes)
+        range_p50/p99_ns       range() over a random 10 s window of one sensor
+        latest_p50/p99_ns      latest_n(100)
+
+    Build (from the repository root):
+        g++ -std=c++20 -O2 -I. bench/history_bench.cpp -pthread -o history_bench
+
+    Output: one JSON object per line on stdout (JSON lines).
+
+    Usage: history_bench [sensors] [queries]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include "measurement.h"
+#include "history_store.h"
+
+enum class payload_shape { CONSTANT, SLOW, NOISY };
+
+static constexpr size_t samples_per_sensor = 60000; //60 s at 1 kHz
+static constexpr int64_t period_ns = 1000000;
+
+// nth_element based, reorders samples
+static uint64_t percentile(std::vector<uint64_t> &samples, double pct) {
+    if (samples.empty()) {
+        return 0;
+    }
+    size_t idx = std::min(samples.size() - 1, static_cast<size_t>(pct * static_cast<double>(samples.size())));
+    std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return samples[idx];
+}
+
+static const char* shape_name(payload_shape shape) {
+    switch (shape) {
+    case payload_shape::CONSTANT: return "constant";
+    case payload_shape::SLOW: return "slow";
+    default: return "noisy";
+    }
+}
+
+static void run_case(payload_shape shape, size_t sensors, size_t queries) {
+    history_config conf;
+    conf.max_sensors = sensors;
+    conf.memory_cap_bytes = 256 * 1024 * 1024; //large enough to keep everything, eviction is not measured here
+    history_store history(conf);
+    std::mt19937 rng(42);
+
+    std::vector<measurement> batch(sensors);
+    for (size_t s = 0; s < sensors; s++) {
+        batch[s].sensor_id = s;
+        batch[s].payload.resize(8);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < samples_per_sensor; i++) {
+        for (size_t s = 0; s < sensors; s++) {
+            measurement &m = batch[s];
+            int64_t jitter = static_cast<int64_t>(rng() % (period_ns / 50)) - period_ns / 100;
+            m.system_timestamp = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(static_cast<int64_t>(i) * period_ns + jitter));
+            m.sequence_number = i;
+            for (size_t ch = 0; ch < 4; ch++) {
+                int16_t v = static_cast<int16_t>(1000 * ch + s);
+                if (shape != payload_shape::CONSTANT) {
+                    v = static_cast<int16_t>(v + static_cast<int16_t>(i / 10));
+                }
+                if (shape == payload_shape::NOISY) {
+                    v = static_cast<int16_t>((v & ~0xFF) | (rng() & 0xFF));
+                }
+                std::memcpy(m.payload.data() + 2 * ch, &v, sizeof(v));
+            }
+            history.append(m);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    size_t total = samples_per_sensor * sensors;
+    double ingest_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) / static_cast<double>(total);
+
+    std::vector<uint64_t> range_ns;
+    std::vector<uint64_t> latest_ns;
+    std::vector<measurement> out;
+    size_t returned = 0;
+    for (size_t q = 0; q < queries; q++) {
+        size_t s = rng() % sensors;
+        int64_t t0 = static_cast<int64_t>(rng() % (samples_per_sensor - 10000)) * period_ns;
+        auto from = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(t0));
+
+        out.clear();
+        auto q0 = std::chrono::steady_clock::now();
+        returned += history.range(s, from, from + std::chrono::seconds(10), out);
+        auto q1 = std::chrono::steady_clock::now();
+        out.clear();
+        history.latest_n(s, 100, out);
+        auto q2 = std::chrono::steady_clock::now();
+
+        range_ns.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(q1 - q0).count()));
+        latest_ns.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(q2 - q1).count()));
+    }
+
+    history_stats st = history.stats();
+    std::printf("{\"payload\":\"%s\",\"sensors\":%zu,\"samples\":%zu,\"chunks\":%zu,\"ingest_ns_per_sample\":%.1f,"
+                "\"bytes_per_sample\":%.2f,\"reserved_bytes\":%zu,\"range_samples_avg\":%.0f,"
+                "\"range_p50_ns\":%llu,\"range_p99_ns\":%llu,\"latest_p50_ns\":%llu,\"latest_p99_ns\":%llu}\n",
+        shape_name(shape), sensors, st.samples, st.chunks, ingest_ns, st.bytes_per_sample(), st.reserved_bytes,
+        (queries != 0) ? static_cast<double>(returned) / static_cast<double>(queries) : 0.0,
+        static_cast<unsigned long long>(percentile(range_ns, 0.50)),
+        static_cast<unsigned long long>(percentile(range_ns, 0.99)),
+        static_cast<unsigned long long>(percentile(latest_ns, 0.50)),
+        static_cast<unsigned long long>(percentile(latest_ns, 0.99)));
+    std::fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    size_t sensors = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 16;
+    size_t queries = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 1000;
+
+    run_case(payload_shape::CONSTANT, sensors, queries);
+    run_case(payload_shape::SLOW, sensors, queries);
+    run_case(payload_shape::NOISY, sensors, queries);
+    return 0;
+}
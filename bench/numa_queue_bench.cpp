@@ -0,0 +1,194 @@
+/*
+    Cross-socket cost of the global queue slot placement (memory_policy).
+
+    - producers: `producers` threads pinned to the CPUs of producer_node, push measurements
+      (16 byte payload, system_timestamp = now), retry on FULL
+    - consumer: one thread pinned to the CPUs of consumer_node, pops with a yield backoff
+
+    Placements of the lockless_global_queue slot array:
+        bind_consumer        : numa_node = consumer_node (mbind)
+        bind_producer        : numa_node = producer_node (mbind)
+        touch_consumer       : no binding, queue constructed by a thread on consumer_node (first touch there)
+        touch_producer       : no binding, queue constructed by a thread on producer_node
+
+    Run it on a multi-socket host with two different nodes, e.g. `numa_queue_bench 10000000 0 1`.
+    With the same node twice every placement is local and the runs should match.
+
+    Reported per placement: ns per item, items/s, p50 / p99 push-to-pop latency. A placement whose
+    mbind fails (no NUMA support) reports its error instead.
+
+    Build (from the repository root):
+        g++ -std=c++20 -O2 -I. bench/numa_queue_bench.cpp -pthread -o numa_queue_bench
+
+    Output: one JSON object per line on stdout (JSON lines).
+
+    Usage: numa_queue_bench [items] [producer_node] [consumer_node] [producers]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <system_error>
+#include <pthread.h>
+#include <sched.h>
+#include "measurement.h"
+#include "memory_policy.h"
+#include "lockless_global_queue.h"
+
+using bench_queue = lockless_global_queue<measurement>;
+
+static constexpr size_t queue_capacity = 4096;
+static constexpr size_t payload_bytes = 16;
+
+// nth_element based, reorders samples
+static uint64_t percentile(std::vector<uint64_t> &samples, double pct) {
+    if (samples.empty()) {
+        return 0;
+    }
+    size_t idx = std::min(samples.size() - 1, static_cast<size_t>(pct * static_cast<double>(samples.size())));
+    std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return samples[idx];
+}
+
+// CPUs of a NUMA node from /sys/devices/system/node/node<N>/cpulist ("0-3,8-11"), empty when unknown
+static cpu_set_t node_cpus(int node, bool &found) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    found = false;
+    char path[64];
+    std::snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    FILE *f = std::fopen(path, "r");
+    if (f == nullptr) {
+        return set;
+    }
+    char line[1024];
+    if (std::fgets(line, sizeof(line), f) != nullptr) {
+        char *p = line;
+        while (true) {
+            char *end;
+            long first = std::strtol(p, &end, 10);
+            if (end == p) {
+                break;
+            }
+            long last = first;
+            if (*end == '-') {
+                last = std::strtol(end + 1, &end, 10);
+            }
+            for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+                CPU_SET(static_cast<int>(cpu), &set);
+                found = true;
+            }
+            if (*end != ',') {
+                break;
+            }
+            p = end + 1;
+        }
+    }
+    std::fclose(f);
+    return set;
+}
+
+static void pin_self(const cpu_set_t &set) {
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0) {
+        throw std::system_error(err, std::generic_category(), "pthread_setaffinity_np failed ");
+    }
+}
+
+static void run_case(const char *placement, size_t items, int producer_node, int consumer_node, size_t producers, int bind_node, int touch_node) {
+    bool found_p;
+    bool found_c;
+    cpu_set_t producer_set = node_cpus(producer_node, found_p);
+    cpu_set_t consumer_set = node_cpus(consumer_node, found_c);
+    if (!found_p || !found_c) {
+        std::printf("{\"placement\":\"%s\",\"error\":\"node cpulist not found\"}\n", placement);
+        std::fflush(stdout);
+        return;
+    }
+
+    //construct (and so first touch) the slot array on touch_node
+    std::unique_ptr<bench_queue> q;
+    std::string error;
+    std::thread builder([&] {
+        try {
+            bool found;
+            pin_self(node_cpus(touch_node, found));
+            memory_policy policy;
+            policy.numa_node = bind_node;
+            q = std::make_unique<bench_queue>(queue_capacity, policy);
+        }
+        catch (const std::exception &e) {
+            error = e.what();
+        }
+    });
+    builder.join();
+    if (!q) {
+        std::printf("{\"placement\":\"%s\",\"error\":\"%s\"}\n", placement, error.c_str());
+        std::fflush(stdout);
+        return;
+    }
+
+    size_t per_producer = items / producers;
+    size_t total = per_producer * producers;
+    std::vector<uint64_t> latencies;
+    latencies.reserve(total);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < producers; t++) {
+        threads.emplace_back([&] {
+            pin_self(producer_set);
+            for (size_t i = 0; i < per_producer; i++) {
+                measurement m;
+                m.payload.assign(payload_bytes, static_cast<uint8_t>(i));
+                m.system_timestamp = std::chrono::steady_clock::now();
+                while (q->push(std::move(m)) == queue_status::FULL) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    std::thread consumer([&] {
+        pin_self(consumer_set);
+        measurement m;
+        while (latencies.size() < total) {
+            if (q->pop(m) != queue_status::OK) {
+                std::this_thread::yield();
+                continue;
+            }
+            latencies.push_back(static_cast<uint64_t>((std::chrono::steady_clock::now() - m.system_timestamp).count()));
+        }
+    });
+    for (auto &t : threads) {
+        t.join();
+    }
+    consumer.join();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("{\"placement\":\"%s\",\"producer_node\":%d,\"consumer_node\":%d,\"producers\":%zu,\"items\":%zu,"
+                "\"ns_per_item\":%.1f,\"items_per_s\":%.0f,\"latency_p50_ns\":%llu,\"latency_p99_ns\":%llu}\n",
+        placement, producer_node, consumer_node, producers, total,
+        sec * 1e9 / static_cast<double>(total), static_cast<double>(total) / sec,
+        static_cast<unsigned long long>(percentile(latencies, 0.50)),
+        static_cast<unsigned long long>(percentile(latencies, 0.99)));
+    std::fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    size_t items = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    int producer_node = (argc > 2) ? std::atoi(argv[2]) : 0;
+    int consumer_node = (argc > 3) ? std::atoi(argv[3]) : 1;
+    size_t producers = (argc > 4) ? std::max<size_t>(1, std::strtoull(argv[4], nullptr, 10)) : 1;
+
+    run_case("bind_consumer", items, producer_node, consumer_node, producers, consumer_node, consumer_node);
+    run_case("bind_producer", items, producer_node, consumer_node, producers, producer_node, producer_node);
+    run_case("touch_consumer", items, producer_node, consumer_node, producers, -1, consumer_node);
+    run_case("touch_producer", items, producer_node, consumer_node, producers, -1, producer_node);
+    return 0;
+}
@@ -0,0 +1,141 @@
+/*
+    uart_frame_parser goodput under bit errors: legacy vs backtrack_resync vs confirm_lock.
+
+    - stream: `frames` SYNC|LEN|PAYLOAD|CRC frames back to back, payload 4..32 bytes, the first 4 bytes are
+      the frame index, the rest is random with one byte in 16 set to 0xAA (sync bytes inside payloads are
+      what makes the parser lock on a wrong offset)
+    - channel: every bit of the stream is flipped with probability BER (same errors for every mode)
+    - parser: fed in 16 byte chunks (never more frames per chunk than it buffers), drained after every chunk
+
+    Modes (uart_parser_config):
+        legacy       : default config
+        backtrack    : backtrack_resync
+        confirm      : confirm_lock
+        both         : backtrack_resync + confirm_lock
+
+    Reported per BER and mode:
+        clean_frames  frames without a flipped bit (what a perfect parser delivers)
+        good          emitted frames equal to the sent frame with that index
+        false_frames  emitted frames that were never sent (CRC collisions after a wrong lock)
+        goodput       good / clean_frames
+        crc_errors, resync_attempts, recovered, unconfirmed_drops (parser counters), parse MB/s
+
+    Build (from the repository root):
+        g++ -std=c++20 -O2 -I. bench/parser_goodput.cpp -o parser_goodput
+
+    Output: one JSON object per line on stdout (JSON lines).
+
+    Usage: parser_goodput [frames] [seed]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include "crc8.h"
+#include "measurement.h"
+#include "uart_frame_parser.h"
+
+static constexpr size_t chunk_bytes = 16;
+
+struct sent_stream {
+    std::vector<std::vector<uint8_t>> payloads;
+    std::vector<uint8_t> bytes;
+    std::vector<size_t> frame_start; //offset of every frame in bytes, plus the end
+};
+
+static sent_stream make_stream(size_t frames, std::mt19937 &rng) {
+    sent_stream s;
+    s.payloads.reserve(frames);
+    s.frame_start.reserve(frames + 1);
+    for (size_t i = 0; i < frames; i++) {
+        std::vector<uint8_t> payload(4 + rng() % 29);
+        uint32_t index = static_cast<uint32_t>(i);
+        std::memcpy(payload.data(), &index, sizeof(index));
+        for (size_t k = 4; k < payload.size(); k++) {
+            payload[k] = (rng() % 16 == 0) ? 0xAA : static_cast<uint8_t>(rng());
+        }
+        s.frame_start.push_back(s.bytes.size());
+        s.bytes.push_back(0xAA);
+        s.bytes.push_back(static_cast<uint8_t>(payload.size()));
+        s.bytes.insert(s.bytes.end(), payload.begin(), payload.end());
+        s.bytes.push_back(crc8::compute(payload.data(), payload.size()));
+        s.payloads.push_back(std::move(payload));
+    }
+    s.frame_start.push_back(s.bytes.size());
+    return s;
+}
+
+// flips every bit with probability ber, returns how many frames came through untouched
+static size_t corrupt(const sent_stream &s, std::vector<uint8_t> &out, double ber, std::mt19937 &rng) {
+    out = s.bytes;
+    std::vector<bool> hit(s.payloads.size(), false);
+    if (ber > 0.0) {
+        //distance to the next flipped bit is geometric
+        std::geometric_distribution<uint64_t> gap(ber);
+        uint64_t bits = static_cast<uint64_t>(out.size()) * 8;
+        for (uint64_t bit = gap(rng); bit < bits; bit += 1 + gap(rng)) {
+            size_t byte = static_cast<size_t>(bit / 8);
+            out[byte] ^= static_cast<uint8_t>(1u << (bit % 8));
+            size_t frame = static_cast<size_t>(std::upper_bound(s.frame_start.begin(), s.frame_start.end(), byte) - s.frame_start.begin()) - 1;
+            hit[frame] = true;
+        }
+    }
+    return static_cast<size_t>(std::count(hit.begin(), hit.end(), false));
+}
+
+static void run_case(const char *mode, const uart_parser_config &conf, const sent_stream &s, const std::vector<uint8_t> &rx, double ber, size_t clean) {
+    uart_frame_parser parser(conf);
+    size_t good = 0;
+    size_t false_frames = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t off = 0; off < rx.size(); off += chunk_bytes) {
+        parser.feed_bytes(rx.data() + off, std::min(chunk_bytes, rx.size() - off));
+        while (parser.has_frame()) {
+            const measurement &m = parser.peek_frame();
+            uint32_t index = 0;
+            if (m.payload.size() >= sizeof(index)) {
+                std::memcpy(&index, m.payload.data(), sizeof(index));
+            }
+            if (index < s.payloads.size() && m.payload == s.payloads[index]) {
+                good++;
+            }
+            else {
+                false_frames++;
+            }
+            parser.pop_frame();
+        }
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("{\"ber\":%g,\"mode\":\"%s\",\"frames\":%zu,\"clean_frames\":%zu,\"good\":%zu,\"false_frames\":%zu,\"goodput\":%.4f,"
+                "\"crc_errors\":%zu,\"resync_attempts\":%zu,\"recovered\":%zu,\"unconfirmed_drops\":%zu,\"parse_mb_per_s\":%.1f}\n",
+        ber, mode, s.payloads.size(), clean, good, false_frames,
+        (clean > 0) ? static_cast<double>(good) / static_cast<double>(clean) : 0.0,
+        parser.error_count(), parser.resync_attempt_count(), parser.recovered_frame_count(), parser.unconfirmed_drop_count(),
+        static_cast<double>(rx.size()) / sec / 1e6);
+    std::fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    size_t frames = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    unsigned seed = (argc > 2) ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10)) : 1;
+
+    std::mt19937 rng(seed);
+    sent_stream s = make_stream(frames, rng);
+    std::vector<uint8_t> rx;
+
+    for (double ber : {0.0, 1e-5, 1e-4, 1e-3, 1e-2}) {
+        size_t clean = corrupt(s, rx, ber, rng);
+        run_case("legacy", uart_parser_config{}, s, rx, ber, clean);
+        run_case("backtrack", uart_parser_config{true, false}, s, rx, ber, clean);
+        run_case("confirm", uart_parser_config{false, true}, s, rx, ber, clean);
+        run_case("both", uart_parser_config{true, true}, s, rx, ber, clean);
+    }
+    return 0;
+}
@@ -0,0 +1,197 @@
+/*
+    Comparative benchmark of the global queue backends.
+
+    Every backend runs the same matrix:
+        producers   : 1, 2, 4, 8, 32
+        payload     : 16, 256, 1024 bytes
+        capacity    : 256, 4096 slots
+        load        : steady (push as fast as possible) / bursty (burst of 64, then 200 us idle)
+    One consumer pops with a short spin / yield backoff (the way batch_consumer does), producers retry on FULL.
+
+    Reported per run:
+        ops_per_s          consumed items / wall time
+        full_retries       push() calls that returned FULL
+        latency_p50/p99_ns push -> pop latency (system_timestamp set right before push)
+        push_p50/p99/p999_ns duration of a single push() call (the producer side cost, contention shows up here)
+
+    Build (from the repository root):
+        g++ -std=c++20 -O2 -I. bench/queue_bench.cpp -pthread -o queue_bench
+
+    Output: one JSON object per line on stdout (JSON lines).
+
+    Usage: queue_bench [items_per_producer]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include "measurement.h"
+#include "queue_concept.h"
+#include "lockless_global_queue.h"
+#include "locking_global_queue.h"
+#include "ticket_global_queue.h"
+#include "cpu_relax.h"
+
+enum class load_shape { STEADY, BURSTY };
+
+struct bench_case {
+    size_t producers;
+    size_t payload_size;
+    size_t capacity;
+    load_shape load;
+    size_t items_per_producer;
+};
+
+struct bench_result {
+    double seconds;
+    uint64_t full_retries;
+    uint64_t latency_p50_ns;
+    uint64_t latency_p99_ns;
+    uint64_t push_p50_ns;
+    uint64_t push_p99_ns;
+    uint64_t push_p999_ns;
+};
+
+// nth_element based, reorders samples
+static uint64_t percentile(std::vector<uint64_t> &samples, double pct) {
+    if (samples.empty()) {
+        return 0;
+    }
+    size_t idx = std::min(samples.size() - 1, static_cast<size_t>(pct * static_cast<double>(samples.size())));
+    std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return samples[idx];
+}
+
+static constexpr size_t burst_items = 64;
+static constexpr std::chrono::microseconds burst_gap{200};
+
+static void backoff(size_t &spins) {
+    if (spins++ < 64) {
+        cpu_relax();
+    }
+    else {
+        std::this_thread::yield();
+    }
+}
+
+template <measurement_queue Queue>
+static bench_result run_case(const bench_case &c) {
+    Queue q(c.capacity, memory_policy{});
+    std::atomic<bool> go{false};
+    std::atomic<uint64_t> full_retries{0};
+    std::vector<std::thread> threads;
+    std::vector<std::vector<uint64_t>> push_ns(c.producers);
+
+    for (size_t p = 0; p < c.producers; p++) {
+        threads.emplace_back([&, p] {
+            std::vector<uint64_t> &push_samples = push_ns[p];
+            push_samples.reserve(c.items_per_producer);
+            measurement proto;
+            proto.sensor_id = p;
+            proto.payload.assign(c.payload_size, static_cast<uint8_t>(p));
+            uint64_t fulls = 0;
+            size_t wait_spins = 0;
+            while (!go.load(std::memory_order_acquire)) {
+                backoff(wait_spins);
+            }
+            for (size_t i = 0; i < c.items_per_producer; i++) {
+                if (c.load == load_shape::BURSTY && i > 0 && i % burst_items == 0) {
+                    std::this_thread::sleep_for(burst_gap);
+                }
+                proto.sequence_number = i;
+                size_t spins = 0;
+                while (true) {
+                    proto.system_timestamp = std::chrono::steady_clock::now();
+                    queue_status q_status = q.push(proto);
+                    push_samples.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - proto.system_timestamp).count()));
+                    if (q_status != queue_status::FULL) {
+                        break;
+                    }
+                    fulls++;
+                    backoff(spins);
+                }
+            }
+            full_retries.fetch_add(fulls, std::memory_order_relaxed);
+        });
+    }
+
+    size_t total = c.producers * c.items_per_producer;
+    std::vector<uint64_t> latencies;
+    latencies.reserve(total);
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+
+    measurement m;
+    size_t spins = 0;
+    while (latencies.size() < total) {
+        if (q.pop(m) == queue_status::OK) {
+            latencies.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m.system_timestamp).count()));
+            spins = 0;
+        }
+        else {
+            backoff(spins);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    std::vector<uint64_t> pushes;
+    for (auto &samples : push_ns) {
+        pushes.insert(pushes.end(), samples.begin(), samples.end());
+    }
+
+    return bench_result{std::chrono::duration<double>(end - start).count(), full_retries.load(),
+        percentile(latencies, 0.50), percentile(latencies, 0.99),
+        percentile(pushes, 0.50), percentile(pushes, 0.99), percentile(pushes, 0.999)};
+}
+
+template <measurement_queue Queue>
+static void run_matrix(const char *backend, size_t items_per_producer) {
+    const size_t producer_counts[] = {1, 2, 4, 8, 32};
+    const size_t payload_sizes[] = {16, 256, 1024};
+    const size_t capacities[] = {256, 4096};
+    const load_shape loads[] = {load_shape::STEADY, load_shape::BURSTY};
+
+    for (load_shape load : loads) {
+        for (size_t capacity : capacities) {
+            for (size_t producers : producer_counts) {
+                for (size_t payload : payload_sizes) {
+                    bench_case c{producers, payload, capacity, load, items_per_producer};
+                    bench_result r = run_case<Queue>(c);
+                    size_t items = producers * items_per_producer;
+                    std::printf("{\"backend\":\"%s\",\"producers\":%zu,\"payload_bytes\":%zu,\"capacity\":%zu,\"load\":\"%s\","
+                                "\"items\":%zu,\"seconds\":%.6f,\"ops_per_s\":%.0f,\"full_retries\":%llu,"
+                                "\"latency_p50_ns\":%llu,\"latency_p99_ns\":%llu,\"push_p50_ns\":%llu,\"push_p99_ns\":%llu,\"push_p999_ns\":%llu}\n",
+                        backend, producers, payload, capacity, (load == load_shape::STEADY) ? "steady" : "bursty",
+                        items, r.seconds, static_cast<double>(items) / r.seconds,
+                        static_cast<unsigned long long>(r.full_retries),
+                        static_cast<unsigned long long>(r.latency_p50_ns),
+                        static_cast<unsigned long long>(r.latency_p99_ns),
+                        static_cast<unsigned long long>(r.push_p50_ns),
+                        static_cast<unsigned long long>(r.push_p99_ns),
+                        static_cast<unsigned long long>(r.push_p999_ns));
+                    std::fflush(stdout);
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t items_per_producer = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 50000;
+
+    run_matrix<lockless_global_queue<measurement>>("lockless", items_per_producer);
+    run_matrix<locking_global_queue<measurement>>("locking", items_per_producer);
+    run_matrix<ticket_global_queue<measurement>>("ticket", items_per_producer);
+    return 0;
+}
@@ -0,0 +1,209 @@
+/*
+    Slow sensor + saturated queue: frame latency with and without the queue space wakeup.
+
+    - slow sensor: one SYNC|LEN|PAYLOAD|CRC frame every period (default 200 ms) over a pipe,
+      the payload is the steady_clock send time, parsed by a sensor_worker
+    - flood: a producer thread that keeps the global queue at capacity for 10 ms every 50 ms
+    - consumer: pops at most 16 items per ms (so a full queue needs ~8 ms to reach the low-water mark)
+
+    A slow sensor frame that hits FULL waits:
+        wake off : for the next bytes of the sensor (one period later)
+        wake on  : until the consumer drained the queue to the low-water mark (queue_space_notifier)
+
+    The wake on case also runs with an aggregation stage (KEEP_EVERY_NTH, N = 1): the frame that hits FULL
+    is then a pending stage output, not a parser frame, and must be retried on the wakeup as well.
+
+    Reported per mode: frame latency send -> pop (p50 / p99 / max), FULL retries of the worker, space wakeups.
+
+    Build (from the repository root):
+        g++ -std=c++20 -O2 -I. bench/queue_space_bench.cpp stream_buffer.cpp -pthread -o queue_space_bench
+
+    Output: one JSON object per line on stdout (JSON lines).
+
+    Usage: queue_space_bench [frames] [period_ms]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include "unique_fd.h"
+#include "crc8.h"
+#include "measurement.h"
+#include "lockless_global_queue.h"
+#include "uart_frame_parser.h"
+#include "aggregation_stage.h"
+#include "sensor_worker.h"
+
+using bench_queue = lockless_global_queue<measurement>;
+
+static constexpr size_t queue_capacity = 256;
+static constexpr size_t slow_sensor = 0;
+static constexpr size_t flood_sensor = 99;
+
+/*
+    Pipe backed source (stands in for a tty), wake_support switches read_bytes_or_wake()
+    between polling the wake fd and the sensor_source default (ignore it).
+*/
+class pipe_source : public sensor_source
+{
+private:
+    int rfd;
+    unique_fd stopfd;
+    bool wake_support;
+
+public:
+    pipe_source(int read_fd, bool wake) : rfd(read_fd), stopfd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), wake_support(wake) {}
+
+    ssize_t read_bytes(uint8_t *buf, size_t buf_len) override {
+        return poll_read(buf, buf_len, -1);
+    }
+
+    ssize_t read_bytes_or_wake(uint8_t *buf, size_t buf_len, int wake_fd) override {
+        return poll_read(buf, buf_len, wake_support ? wake_fd : -1);
+    }
+
+    ssize_t poll_read(uint8_t *buf, size_t buf_len, int wake_fd) {
+        pollfd plfd[3]{};
+        plfd[0].fd = rfd;
+        plfd[1].fd = stopfd.get();
+        plfd[2].fd = wake_fd;
+        for (auto &p : plfd) {
+            p.events = POLLIN;
+        }
+        while (true) {
+            if (poll(plfd, (wake_fd >= 0) ? 3 : 2, -1) < 0) {
+                if (errno == EINTR) continue;
+                return -1;
+            }
+            if (plfd[1].revents & POLLIN) {
+                uint64_t v;
+                (void)read(stopfd.get(), &v, sizeof(v));
+                return 0;
+            }
+            if (plfd[0].revents & (POLLIN | POLLHUP)) {
+                ssize_t ret = read(rfd, buf, buf_len);
+                return (ret >= 0) ? ret : -1;
+            }
+            if (plfd[2].revents & POLLIN) {
+                return woken;
+            }
+        }
+    }
+
+    int stop_request() override {
+        uint64_t one = 1;
+        return (write(stopfd.get(), &one, sizeof(one)) == sizeof(one)) ? 0 : -1;
+    }
+};
+
+// nth_element based, reorders samples
+static uint64_t percentile(std::vector<uint64_t> &samples, double pct) {
+    if (samples.empty()) {
+        return 0;
+    }
+    size_t idx = std::min(samples.size() - 1, static_cast<size_t>(pct * static_cast<double>(samples.size())));
+    std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return samples[idx];
+}
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void run_case(bool wake, bool aggregated, size_t frames, std::chrono::milliseconds period) {
+    int pfd[2];
+    if (pipe(pfd) != 0) {
+        return;
+    }
+    bench_queue q(queue_capacity, memory_policy{});
+    pipe_source source(pfd[0], wake);
+    uart_frame_parser parser;
+    aggregation_config aggr_conf;
+    aggr_conf.mode = aggregation_mode::KEEP_EVERY_NTH;
+    aggregation_stage stage(aggr_conf);
+    sensor_worker<bench_queue> worker(4096, slow_sensor, source, parser, q, aggregated ? &stage : nullptr);
+    worker.start();
+
+    std::atomic<bool> done{false};
+
+    std::thread flood([&] {
+        measurement proto;
+        proto.sensor_id = flood_sensor;
+        proto.payload.assign(8, 0);
+        while (!done.load()) {
+            auto burst_end = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+            while (std::chrono::steady_clock::now() < burst_end) {
+                if (q.push(proto) == queue_status::FULL) {
+                    std::this_thread::yield();
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(40));
+        }
+    });
+
+    std::vector<uint64_t> latencies;
+    std::thread consumer([&] {
+        measurement m;
+        while (latencies.size() < frames && !done.load()) {
+            for (size_t i = 0; i < 16 && q.pop(m) == queue_status::OK; i++) {
+                if (m.sensor_id == slow_sensor && m.payload.size() == sizeof(int64_t)) {
+                    int64_t sent;
+                    std::memcpy(&sent, m.payload.data(), sizeof(sent));
+                    latencies.push_back(static_cast<uint64_t>(now_ns() - sent));
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    //slow sensor, the phase against the flood bursts drifts (period is not a multiple of 50 ms)
+    for (size_t i = 0; i < frames; i++) {
+        uint8_t frame[2 + sizeof(int64_t) + 1];
+        int64_t sent = now_ns();
+        frame[0] = 0xAA;
+        frame[1] = sizeof(int64_t);
+        std::memcpy(frame + 2, &sent, sizeof(sent));
+        frame[sizeof(frame) - 1] = crc8::compute(frame + 2, sizeof(int64_t));
+        (void)write(pfd[1], frame, sizeof(frame));
+        std::this_thread::sleep_for(period + std::chrono::milliseconds(static_cast<int64_t>(i % 7)));
+    }
+
+    //last frames may still be waiting for the next bytes (wake off), give them one more period
+    std::this_thread::sleep_for(period);
+    done.store(true);
+    flood.join();
+    consumer.join();
+    worker.stop();
+    close(pfd[0]);
+    close(pfd[1]);
+
+    size_t delivered = latencies.size();
+    std::printf("{\"wake\":%s,\"aggregated\":%s,\"frames\":%zu,\"delivered\":%zu,\"period_ms\":%lld,\"latency_p50_us\":%llu,\"latency_p99_us\":%llu,"
+                "\"latency_max_us\":%llu,\"worker_full_retries\":%zu,\"space_wakeups\":%zu}\n",
+        wake ? "true" : "false", aggregated ? "true" : "false", frames, delivered, static_cast<long long>(period.count()),
+        static_cast<unsigned long long>(percentile(latencies, 0.50) / 1000),
+        static_cast<unsigned long long>(percentile(latencies, 0.99) / 1000),
+        static_cast<unsigned long long>(percentile(latencies, 1.0) / 1000),
+        worker.get_queue_full_failures(), worker.get_space_wakeups());
+    std::fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    size_t frames = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 100;
+    std::chrono::milliseconds period((argc > 2) ? std::strtoll(argv[2], nullptr, 10) : 200);
+
+    run_case(false, false, frames, period);
+    run_case(true, false, frames, period);
+    run_case(true, true, frames, period);
+    return 0;
+}
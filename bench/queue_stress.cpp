@@ -0,0 +1,118 @@
+/*
+    Stress benchmark for lockless_global_queue.
+
+    Sweeps producer count x payload size, one consumer thread pops everything.
+    Producers retry on FULL and the consumer on EMPTY (cpu_relax, yield after a few spins, so an
+    oversubscribed machine still makes progress), the run measures the queue itself, not drop policy.
+
+    Build (from the repository root):
+        g++ -std=c++20 -O2 -DGLOBAL_QUEUE_STATS -I. bench/queue_stress.cpp -pthread -o queue_stress
+
+    Without -DGLOBAL_QUEUE_STATS the contention counters are 0 (stats_enabled false) and only ops/s is meaningful.
+
+    Output: one JSON object per line on stdout (JSON lines), one per configuration.
+
+    Usage: queue_stress [items_per_producer] [capacity]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "measurement.h"
+#include "lockless_global_queue.h"
+#include "cpu_relax.h"
+
+static void backoff(size_t &spins) {
+    if (spins++ < 64) {
+        cpu_relax();
+    }
+    else {
+        std::this_thread::yield();
+    }
+}
+
+struct run_result {
+    double seconds;
+    queue_stats stats;
+};
+
+static run_result run_once(size_t producers, size_t payload_size, size_t items_per_producer, size_t capacity) {
+    lockless_global_queue<measurement> q(capacity);
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+
+    for (size_t p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            measurement proto;
+            proto.sensor_id = p;
+            proto.payload.assign(payload_size, static_cast<uint8_t>(p));
+            size_t wait_spins = 0;
+            while (!go.load(std::memory_order_acquire)) {
+                backoff(wait_spins);
+            }
+            for (size_t i = 0; i < items_per_producer; i++) {
+                proto.sequence_number = i;
+                size_t spins = 0;
+                while (q.push(proto) == queue_status::FULL) {
+                    backoff(spins);
+                }
+            }
+        });
+    }
+
+    size_t total = producers * items_per_producer;
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+
+    measurement m;
+    size_t popped = 0;
+    size_t spins = 0;
+    while (popped < total) {
+        if (q.pop(m) == queue_status::OK) {
+            popped++;
+            spins = 0;
+        }
+        else {
+            backoff(spins);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    for (auto &t : threads) {
+        t.join();
+    }
+    return run_result{std::chrono::duration<double>(end - start).count(), q.stats()};
+}
+
+int main(int argc, char *argv[]) {
+    size_t items_per_producer = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    size_t capacity = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 1024;
+
+    const size_t producer_counts[] = {1, 2, 4, 8};
+    const size_t payload_sizes[] = {16, 64, 256, 1024};
+
+    for (size_t producers : producer_counts) {
+        for (size_t payload : payload_sizes) {
+            run_result r = run_once(producers, payload, items_per_producer, capacity);
+            size_t items = producers * items_per_producer;
+            std::printf("{\"producers\":%zu,\"payload_bytes\":%zu,\"capacity\":%zu,\"items\":%zu,\"seconds\":%.6f,\"ops_per_s\":%.0f,"
+                        "\"push_full\":%llu,\"write_cas_failures\":%llu,\"producer_slot_spins\":%llu,\"pop_empty\":%llu,"
+                        "\"read_cas_failures\":%llu,\"consumer_slot_spins\":%llu,\"occupancy_high_water\":%llu,\"stats_enabled\":%s}\n",
+                producers, payload, capacity, items, r.seconds, static_cast<double>(items) / r.seconds,
+                static_cast<unsigned long long>(r.stats.push_full),
+                static_cast<unsigned long long>(r.stats.write_cas_failures),
+                static_cast<unsigned long long>(r.stats.producer_slot_spins),
+                static_cast<unsigned long long>(r.stats.pop_empty),
+                static_cast<unsigned long long>(r.stats.read_cas_failures),
+                static_cast<unsigned long long>(r.stats.consumer_slot_spins),
+                static_cast<unsigned long long>(r.stats.occupancy_high_water),
+                lockless_global_queue<measurement>::stats_enabled() ? "true" : "false");
+            std::fflush(stdout);
+        }
+    }
+    return 0;
+}
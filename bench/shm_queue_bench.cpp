@@ -0,0 +1,186 @@
+/*
+    Per-item cost of shm_global_queue against the in-process lockless_global_queue.
+
+    - producer: builds a measurement (payload of `payload` bytes, system_timestamp = now) and pushes it,
+      retries on FULL
+    - consumer: lockless_global_queue pops into a reused measurement, shm_global_queue reads the slot
+      in place (peek / release), both spin with yield on EMPTY
+
+    Modes:
+        same_thread   : push then pop in one thread, the cost of the queue operations alone
+                        (lockless, shm)
+        threads       : producer thread and consumer thread in one process (lockless, shm)
+        process       : shm only, the producer is a forked child registered with register_producer()
+
+    Reported per mode and queue: ns per item (consumer wall time / items), items/s and, for the
+    two-sided modes, p50 / p99 push-to-pop latency (steady_clock is system wide, so it compares across
+    processes).
+
+    Build (from the repository root):
+        g++ -std=c++20 -O2 -I. bench/shm_queue_bench.cpp -pthread -o shm_queue_bench
+
+    Output: one JSON object per line on stdout (JSON lines).
+
+    Usage: shm_queue_bench [items] [payload] [capacity]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "measurement.h"
+#include "lockless_global_queue.h"
+#include "shm_global_queue.h"
+
+static constexpr size_t max_payload = 1024;
+
+using inproc_queue = lockless_global_queue<measurement>;
+using shared_queue = shm_global_queue<max_payload>;
+
+// nth_element based, reorders samples
+static uint64_t percentile(std::vector<uint64_t> &samples, double pct) {
+    if (samples.empty()) {
+        return 0;
+    }
+    size_t idx = std::min(samples.size() - 1, static_cast<size_t>(pct * static_cast<double>(samples.size())));
+    std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return samples[idx];
+}
+
+static measurement make_item(size_t i, size_t payload) {
+    measurement m;
+    m.payload.assign(payload, static_cast<uint8_t>(i));
+    m.sensor_id = 1;
+    m.sequence_number = i;
+    m.system_timestamp = std::chrono::steady_clock::now();
+    return m;
+}
+
+template <typename Queue>
+static void produce(Queue &q, size_t items, size_t payload) {
+    for (size_t i = 0; i < items; i++) {
+        measurement m = make_item(i, payload);
+        while (q.push(m) == queue_status::FULL) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// pops sequence numbers [first, end), one latency sample per item, returns false on a sequence gap
+static bool consume(inproc_queue &q, size_t first, size_t end, std::vector<uint64_t> &latencies) {
+    measurement m;
+    bool in_order = true;
+    for (size_t i = first; i < end; i++) {
+        while (q.pop(m) != queue_status::OK) {
+            std::this_thread::yield();
+        }
+        in_order = in_order && m.sequence_number == i;
+        latencies.push_back(static_cast<uint64_t>((std::chrono::steady_clock::now() - m.system_timestamp).count()));
+    }
+    return in_order;
+}
+
+static bool consume(shared_queue &q, size_t first, size_t end, std::vector<uint64_t> &latencies) {
+    shared_queue::view v;
+    bool in_order = true;
+    for (size_t i = first; i < end; i++) {
+        while (q.peek(v) != queue_status::OK) {
+            std::this_thread::yield();
+        }
+        in_order = in_order && v.sequence_number == i;
+        latencies.push_back(static_cast<uint64_t>((std::chrono::steady_clock::now() - v.system_timestamp).count()));
+        q.release();
+    }
+    return in_order;
+}
+
+static void report(const char *mode, const char *queue, size_t items, size_t payload, double sec, std::vector<uint64_t> &latencies, bool in_order) {
+    std::printf("{\"mode\":\"%s\",\"queue\":\"%s\",\"items\":%zu,\"payload\":%zu,\"ns_per_item\":%.1f,\"items_per_s\":%.0f,"
+                "\"latency_p50_ns\":%llu,\"latency_p99_ns\":%llu,\"in_order\":%s}\n",
+        mode, queue, items, payload, sec * 1e9 / static_cast<double>(items), static_cast<double>(items) / sec,
+        static_cast<unsigned long long>(percentile(latencies, 0.50)),
+        static_cast<unsigned long long>(percentile(latencies, 0.99)),
+        in_order ? "true" : "false");
+    std::fflush(stdout);
+}
+
+template <typename Queue>
+static void run_same_thread(Queue &q, const char *queue, size_t items, size_t payload) {
+    std::vector<uint64_t> latencies;
+    latencies.reserve(items);
+    bool in_order = true;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < items; i++) {
+        q.push(make_item(i, payload));
+        in_order = consume(q, i, i + 1, latencies) && in_order;
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report("same_thread", queue, items, payload, sec, latencies, in_order);
+}
+
+template <typename Queue>
+static void run_threads(Queue &q, const char *queue, size_t items, size_t payload) {
+    std::vector<uint64_t> latencies;
+    latencies.reserve(items);
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&] { produce(q, items, payload); });
+    bool in_order = consume(q, 0, items, latencies);
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    producer.join();
+    report("threads", queue, items, payload, sec, latencies, in_order);
+}
+
+static void run_process(size_t capacity, size_t items, size_t payload) {
+    shared_queue q = shared_queue::create(capacity);
+    q.register_consumer();
+
+    std::vector<uint64_t> latencies;
+    latencies.reserve(items);
+    auto start = std::chrono::steady_clock::now();
+    pid_t child = fork();
+    if (child < 0) {
+        std::perror("fork");
+        return;
+    }
+    if (child == 0) {
+        //the mapping is inherited, the child only needs its own producer slot
+        q.register_producer();
+        produce(q, items, payload);
+        q.unregister_producer();
+        _exit(0);
+    }
+    bool in_order = consume(q, 0, items, latencies);
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    waitpid(child, nullptr, 0);
+    report("process", "shm", items, payload, sec, latencies, in_order);
+}
+
+int main(int argc, char *argv[]) {
+    size_t items = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t payload = (argc > 2) ? std::min<size_t>(std::strtoull(argv[2], nullptr, 10), max_payload) : 16;
+    size_t capacity = (argc > 3) ? std::strtoull(argv[3], nullptr, 10) : 1024;
+
+    {
+        inproc_queue q(capacity, memory_policy{});
+        run_same_thread(q, "lockless", items, payload);
+    }
+    {
+        shared_queue q = shared_queue::create(capacity);
+        run_same_thread(q, "shm", items, payload);
+    }
+    {
+        inproc_queue q(capacity, memory_policy{});
+        run_threads(q, "lockless", items, payload);
+    }
+    {
+        shared_queue q = shared_queue::create(capacity);
+        run_threads(q, "shm", items, payload);
+    }
+    run_process(capacity, items, payload);
+    return 0;
+}
@@ -0,0 +1,138 @@
+/*
+    uart_sensor_source: wake-to-parse latency, poll mode vs busy_poll mode, over a pty.
+
+    - sender: writes one SYNC|LEN|PAYLOAD|CRC frame every period to the pty master,
+      the payload is the steady_clock time of that write
+    - sensor: uart_sensor_source on the pty slave, parsed by a sensor_worker
+    - consumer: pops the global queue, latency = measurement.system_timestamp (set when the frame
+      is parsed) - write time
+
+    Modes:
+        poll      : read_bytes() blocks in poll() (default)
+        busy_poll : read_bytes() spins for spin_budget before falling back to poll()
+
+    The pty stands in for the serial driver: kernel_low_latency is not supported there, and the
+    tty flip buffer work is the same as for a real uart, the line rate is not modelled.
+
+    Reported per mode: p50 / p99 / p99.9 / max latency, frames delivered, parser errors.
+
+    Build (from the repository root):
+        g++ -std=c++20 -O2 -I. bench/uart_latency_bench.cpp stream_buffer.cpp uart_baud.cpp -pthread -o uart_latency_bench
+
+    Output: one JSON object per line on stdout (JSON lines).
+
+    Usage: uart_latency_bench [frames] [period_us] [spin_budget_us]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <pty.h>
+#include <unistd.h>
+#include "crc8.h"
+#include "measurement.h"
+#include "lockless_global_queue.h"
+#include "uart_frame_parser.h"
+#include "uart_sensor_source.h"
+#include "sensor_worker.h"
+
+using bench_queue = lockless_global_queue<measurement>;
+
+static constexpr size_t frame_bytes = 2 + sizeof(int64_t) + 1;
+
+// nth_element based, reorders samples
+static uint64_t percentile(std::vector<uint64_t> &samples, double pct) {
+    if (samples.empty()) {
+        return 0;
+    }
+    size_t idx = std::min(samples.size() - 1, static_cast<size_t>(pct * static_cast<double>(samples.size())));
+    std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return samples[idx];
+}
+
+static int64_t to_ns(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+static void run_case(bool busy_poll, size_t frames, std::chrono::microseconds period, std::chrono::microseconds spin_budget) {
+    int master_fd;
+    int slave_fd;
+    char slave_name[64];
+    if (openpty(&master_fd, &slave_fd, slave_name, nullptr, nullptr) != 0) {
+        std::perror("openpty");
+        return;
+    }
+
+    uart_config conf{slave_name, 115200, data_bits::eight, parity::N, stop_bits::one};
+    conf.low_latency.busy_poll = busy_poll;
+    conf.low_latency.spin_budget = spin_budget;
+    uart_sensor_source source(conf);
+    uart_frame_parser parser;
+    bench_queue q(1024, memory_policy{});
+    sensor_worker<bench_queue> worker(4096, 0, source, parser, q);
+    worker.start();
+
+    std::vector<uint64_t> latencies;
+    latencies.reserve(frames);
+    std::atomic<bool> done{false};
+    std::thread consumer([&] {
+        measurement m;
+        while (latencies.size() < frames && !done.load()) {
+            if (q.pop(m) != queue_status::OK) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+            int64_t sent;
+            std::memcpy(&sent, m.payload.data(), sizeof(sent));
+            latencies.push_back(static_cast<uint64_t>(to_ns(m.system_timestamp) - sent));
+        }
+    });
+
+    auto next = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < frames; i++) {
+        next += period;
+        std::this_thread::sleep_until(next);
+        uint8_t frame[frame_bytes];
+        int64_t sent = to_ns(std::chrono::steady_clock::now());
+        frame[0] = 0xAA;
+        frame[1] = sizeof(int64_t);
+        std::memcpy(frame + 2, &sent, sizeof(sent));
+        frame[frame_bytes - 1] = crc8::compute(frame + 2, sizeof(int64_t));
+        (void)write(master_fd, frame, sizeof(frame));
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    done.store(true);
+    consumer.join();
+    worker.stop();
+    close(slave_fd);
+    close(master_fd);
+
+    size_t delivered = latencies.size();
+    std::printf("{\"mode\":\"%s\",\"frames\":%zu,\"delivered\":%zu,\"period_us\":%lld,\"spin_budget_us\":%lld,"
+                "\"latency_p50_us\":%.1f,\"latency_p99_us\":%.1f,\"latency_p999_us\":%.1f,\"latency_max_us\":%.1f,\"parser_errors\":%zu}\n",
+        busy_poll ? "busy_poll" : "poll", frames, delivered, static_cast<long long>(period.count()),
+        busy_poll ? static_cast<long long>(spin_budget.count()) : 0LL,
+        static_cast<double>(percentile(latencies, 0.50)) / 1000.0,
+        static_cast<double>(percentile(latencies, 0.99)) / 1000.0,
+        static_cast<double>(percentile(latencies, 0.999)) / 1000.0,
+        static_cast<double>(percentile(latencies, 1.0)) / 1000.0,
+        parser.error_count());
+    std::fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    size_t frames = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 10000;
+    std::chrono::microseconds period((argc > 2) ? std::strtoll(argv[2], nullptr, 10) : 1000);
+    std::chrono::microseconds spin_budget((argc > 3) ? std::strtoll(argv[3], nullptr, 10) : 2000);
+
+    run_case(false, frames, period, spin_budget);
+    run_case(true, frames, period, spin_budget);
+    return 0;
+}
@@ -0,0 +1,174 @@
+/*
+    Loopback load test of udp_sensor_source + packet_worker.
+
+    One sender thread per receiver blasts datagrams at 127.0.0.1 (each sender has its own socket,
+    so SO_REUSEPORT spreads the flows over the receivers). Every receiver is a udp_sensor_source
+    bound to the same port with a packet_worker pushing into one lockless global queue, drained by
+    one consumer.
+
+    Matrix:
+        receivers : 1, 2, 4 (SO_REUSEPORT when > 1)
+        batch     : 1, 32 datagrams per recvmmsg()
+        rcvbuf    : system default, 4 MB (SO_RCVBUF, capped by net.core.rmem_max)
+
+    Reported per run:
+        sent / received        datagrams
+        packets_per_s          received / time from the first send to the last pop
+        kernel_drops           sum of the SO_RXQ_OVFL counters (socket buffer full)
+        queue_full             datagrams dropped by the workers on a full global queue
+        latency_p50/p99_ns     kernel receive timestamp (SO_TIMESTAMPNS) -> pop
+
+    Build (from the repository root):
+        g++ -std=c++20 -O2 -I. bench/udp_loopback.cpp -pthread -o udp_loopback
+
+    Output: one JSON object per line on stdout (JSON lines).
+
+    Usage: udp_loopback [datagrams_per_sender] [payload_bytes]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "measurement.h"
+#include "lockless_global_queue.h"
+#include "udp_sensor_source.h"
+#include "packet_worker.h"
+
+using bench_queue = lockless_global_queue<measurement>;
+
+struct bench_case {
+    size_t receivers;
+    size_t batch;
+    int rcvbuf_bytes;
+    size_t datagrams_per_sender;
+    size_t payload_size;
+};
+
+// nth_element based, reorders samples
+static uint64_t percentile(std::vector<uint64_t> &samples, double pct) {
+    if (samples.empty()) {
+        return 0;
+    }
+    size_t idx = std::min(samples.size() - 1, static_cast<size_t>(pct * static_cast<double>(samples.size())));
+    std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return samples[idx];
+}
+
+static void sender(uint16_t port, size_t datagrams, size_t payload_size) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return;
+    }
+    sockaddr_in dst{};
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(port);
+    dst.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    connect(fd, reinterpret_cast<sockaddr*>(&dst), sizeof(dst));
+
+    std::vector<uint8_t> payload(payload_size, 0x5A);
+    for (size_t i = 0; i < datagrams; i++) {
+        while (send(fd, payload.data(), payload.size(), 0) < 0 && errno == ENOBUFS) {
+            std::this_thread::yield();
+        }
+    }
+    close(fd);
+}
+
+static void run_case(const bench_case &c) {
+    bench_queue q(65536, memory_policy{});
+    std::vector<std::unique_ptr<udp_sensor_source>> sources;
+    std::vector<std::unique_ptr<packet_worker<bench_queue>>> workers;
+
+    udp_config conf;
+    conf.bind_address = "127.0.0.1";
+    conf.batch = c.batch;
+    conf.rcvbuf_bytes = c.rcvbuf_bytes;
+    conf.reuseport = c.receivers > 1;
+    for (size_t r = 0; r < c.receivers; r++) {
+        sources.push_back(std::make_unique<udp_sensor_source>(conf));
+        conf.port = sources.front()->local_port();
+    }
+    for (size_t r = 0; r < c.receivers; r++) {
+        workers.push_back(std::make_unique<packet_worker<bench_queue>>(r, *sources[r], q));
+        workers.back()->start();
+    }
+
+    size_t sent = c.receivers * c.datagrams_per_sender;
+    std::vector<uint64_t> latencies;
+    latencies.reserve(sent);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> senders;
+    for (size_t r = 0; r < c.receivers; r++) {
+        senders.emplace_back(sender, conf.port, c.datagrams_per_sender, c.payload_size);
+    }
+
+    //drain until everything arrived or nothing arrived for 200 ms (the rest was dropped)
+    measurement m;
+    auto last_pop = std::chrono::steady_clock::now();
+    auto end = last_pop;
+    while (latencies.size() < sent) {
+        if (q.pop(m) == queue_status::OK) {
+            end = std::chrono::steady_clock::now();
+            last_pop = end;
+            latencies.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - m.system_timestamp).count()));
+        }
+        else if (std::chrono::steady_clock::now() - last_pop > std::chrono::milliseconds(200)) {
+            break;
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+
+    for (auto &t : senders) {
+        t.join();
+    }
+
+    size_t kernel_drops = 0;
+    size_t queue_full = 0;
+    for (size_t r = 0; r < c.receivers; r++) {
+        workers[r]->stop();
+        kernel_drops += sources[r]->get_kernel_drops();
+        queue_full += workers[r]->get_queue_full_failures();
+    }
+
+    size_t received = latencies.size();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::printf("{\"receivers\":%zu,\"batch\":%zu,\"rcvbuf_bytes\":%d,\"payload_bytes\":%zu,\"sent\":%zu,\"received\":%zu,"
+                "\"seconds\":%.6f,\"packets_per_s\":%.0f,\"kernel_drops\":%zu,\"queue_full\":%zu,"
+                "\"latency_p50_ns\":%llu,\"latency_p99_ns\":%llu}\n",
+        c.receivers, c.batch, c.rcvbuf_bytes, c.payload_size, sent, received,
+        seconds, (seconds > 0) ? static_cast<double>(received) / seconds : 0.0, kernel_drops, queue_full,
+        static_cast<unsigned long long>(percentile(latencies, 0.50)),
+        static_cast<unsigned long long>(percentile(latencies, 0.99)));
+    std::fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    size_t datagrams_per_sender = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    size_t payload_size = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 64;
+
+    const size_t receiver_counts[] = {1, 2, 4};
+    const size_t batches[] = {1, 32};
+    const int rcvbufs[] = {0, 4 * 1024 * 1024};
+
+    for (int rcvbuf : rcvbufs) {
+        for (size_t batch : batches) {
+            for (size_t receivers : receiver_counts) {
+                run_case(bench_case{receivers, batch, rcvbuf, datagrams_per_sender, payload_size});
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*
+    zero_copy_worker stress: random SYNC|LEN|PAYLOAD|CRC frames with garbage in between, written over a pipe
+    in random chunk sizes, scanned in place and checked byte by byte by the consumer.
+
+    - writer: `frames` frames (payload 0..64 bytes, byte k of frame i is i + k), a stray byte after every 7th frame,
+      chunks of 1..300 bytes
+    - worker: zero_copy_worker with a small segment pool, so segments rotate (carry) and run out (exhaustions)
+    - consumer: pops and checks every payload against its frame index
+
+    Modes:
+        fast : the consumer pops as fast as it can
+        slow : the consumer sleeps 1 ms every 64 items, the queue fills up and every FULL halts the worker
+               (no frame may be lost: delivered must equal frames)
+
+    Reported per mode: delivered, corrupt payloads, scanner errors, carried bytes, segment exhaustions,
+    FULL retries, free segments at the end (must equal the pool size), elapsed time.
+
+    Build (from the repository root):
+        g++ -std=c++20 -O2 -I. bench/zero_copy_stress.cpp -pthread -o zero_copy_stress
+
+    Output: one JSON object per line on stdout (JSON lines).
+
+    Usage: zero_copy_stress [frames] [queue_capacity]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <unistd.h>
+#include "crc8.h"
+#include "lockless_global_queue.h"
+#include "frame_scanner.h"
+#include "segment_pool.h"
+#include "zero_copy_worker.h"
+
+using bench_queue = lockless_global_queue<view_measurement>;
+
+static constexpr size_t pool_segments = 8;
+static constexpr size_t segment_bytes = 1024;
+
+// blocking pipe read end, the writer closing the pipe is end of stream
+class pipe_source : public sensor_source
+{
+private:
+    int rfd;
+
+public:
+    pipe_source(int read_fd) : rfd(read_fd) {}
+
+    ssize_t read_bytes(uint8_t *buf, size_t buf_len) override {
+        ssize_t ret = read(rfd, buf, buf_len);
+        return (ret >= 0) ? ret : -1;
+    }
+
+    int stop_request() override { return 0; }
+};
+
+static std::vector<uint8_t> make_stream(size_t frames) {
+    std::mt19937 rng(1);
+    std::vector<uint8_t> out;
+    for (size_t i = 0; i < frames; i++) {
+        uint8_t len = static_cast<uint8_t>(rng() % 65);
+        out.push_back(0xAA);
+        out.push_back(len);
+        size_t start = out.size();
+        for (size_t k = 0; k < len; k++) {
+            out.push_back(static_cast<uint8_t>(i + k));
+        }
+        out.push_back(crc8::compute(out.data() + start, len));
+        if (i % 7 == 0) {
+            out.push_back(0x13);
+        }
+    }
+    return out;
+}
+
+static void run_case(bool slow, size_t frames, size_t capacity) {
+    int pfd[2];
+    if (pipe(pfd) != 0) {
+        return;
+    }
+    pipe_source source(pfd[0]);
+    uart_frame_scanner scanner;
+    segment_pool pool(pool_segments, segment_bytes);
+    bench_queue q(capacity, memory_policy{});
+    zero_copy_worker<bench_queue> worker(7, source, scanner, pool, q);
+
+    std::vector<uint8_t> stream = make_stream(frames);
+    auto start = std::chrono::steady_clock::now();
+    worker.start();
+
+    std::atomic<bool> written{false};
+    std::thread writer([&] {
+        std::mt19937 rng(2);
+        size_t off = 0;
+        while (off < stream.size()) {
+            size_t n = std::min<size_t>(1 + rng() % 300, stream.size() - off);
+            ssize_t w = write(pfd[1], stream.data() + off, n);
+            if (w <= 0) {
+                break;
+            }
+            off += static_cast<size_t>(w);
+        }
+        close(pfd[1]);
+        written.store(true);
+    });
+
+    size_t delivered = 0;
+    size_t corrupt = 0;
+    view_measurement vm;
+    auto idle_since = std::chrono::steady_clock::now();
+    while (delivered < frames) {
+        queue_status q_status = q.pop(vm);
+        if (q_status == queue_status::OK) {
+            auto bytes = vm.view.bytes();
+            for (size_t k = 0; k < bytes.size(); k++) {
+                if (bytes[k] != static_cast<uint8_t>(delivered + k)) {
+                    corrupt++;
+                    break;
+                }
+            }
+            vm.view.reset();
+            delivered++;
+            if (slow && delivered % 64 == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            idle_since = std::chrono::steady_clock::now();
+            continue;
+        }
+        //lost frames: nothing more arrives once the writer is done
+        if (written.load() && std::chrono::steady_clock::now() - idle_since > std::chrono::milliseconds(500)) {
+            break;
+        }
+        std::this_thread::yield();
+    }
+    writer.join();
+    worker.stop();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    close(pfd[0]);
+
+    std::printf("{\"mode\":\"%s\",\"frames\":%zu,\"queue_capacity\":%zu,\"delivered\":%zu,\"corrupt\":%zu,\"scanner_errors\":%zu,"
+                "\"carried_bytes\":%zu,\"segment_exhaustions\":%zu,\"full_retries\":%zu,\"free_segments\":%zu,\"elapsed_ms\":%.1f}\n",
+        slow ? "slow" : "fast", frames, capacity, delivered, corrupt, scanner.error_count(),
+        worker.get_carried_bytes(), worker.get_segment_exhaustions(), worker.get_queue_full_failures(), pool.free_count(), sec * 1000.0);
+    std::fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    size_t frames = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 20000;
+    size_t capacity = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 64; //below what the pool holds, so FULL comes before exhaustion
+
+    run_case(false, frames, capacity);
+    run_case(true, frames, capacity);
+    return 0;
+}
@@ -0,0 +1,298 @@
+#ifndef _BROADCAST_RING_H_
+#define _BROADCAST_RING_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <span>
+#include <thread>
+#include <limits>
+#include <stdexcept>
+#include "queue_concept.h"
+#include "cpu_relax.h"
+
+/*
+    Bounded multi producer ring where every consumer sees every item (disruptor style).
+
+    The global queue hands an item to one consumer. Here each consumer has its own sequence cursor
+    and reads the slot in place (const T&), there is no per consumer copy and no re-enqueue:
+
+        workers -> global_queue -> stage_graph sink --publish()--> broadcast_ring -> recorder  (REQUIRED)
+                                                                                  -> alarms    (REQUIRED)
+                                                                                  -> dashboard (LOSSY)
+
+    Consumers:
+    - REQUIRED: producers gate on the slowest required cursor, a full ring makes try_publish() return FULL
+      (publish() waits), so a stalled recorder stalls the pipeline like a full global queue does
+    - LOSSY: never gates the producers on its lag. When it falls more than capacity behind, the overwritten
+      items are skipped and counted (lost()). While a lossy consumer visits items it holds a read marker,
+      a producer about to overwrite one of them waits for that visit only, keep lossy visits short
+
+    Slots carry their own sequence state (writing / published), producers claim sequences with one CAS
+    on the claim cursor, so several producers can publish (each slot is published in place, out of order
+    completion is fine, consumers stop at the first unpublished slot).
+    Producers re-read the required cursors only when the cached gate shows the ring full.
+
+    Consumers are added before the first publish and are read by one thread each:
+        size_t rec = ring.add_consumer(broadcast_consumer::REQUIRED);
+        ring.consume(rec, [](const measurement &m) { ... }, 64);
+    close() after the last publish returned, drained(id) is true once that consumer saw everything.
+
+    capacity is rounded up to a power of 2.
+*/
+
+enum class broadcast_consumer { REQUIRED, LOSSY };
+
+template <typename T>
+class broadcast_ring
+{
+private:
+    static constexpr uint64_t idle = std::numeric_limits<uint64_t>::max();
+
+    //slot state: 0 = never written, writing(s) / published(s) for sequence s
+    static constexpr uint64_t writing(uint64_t s) { return 2 * s + 2; }
+    static constexpr uint64_t published(uint64_t s) { return 2 * s + 3; }
+
+    struct alignas(64) slot {
+        std::atomic<uint64_t> state{0};
+        T value{};
+    };
+
+    struct alignas(64) consumer {
+        std::atomic<uint64_t> cursor{0}; //next sequence to read
+        std::atomic<uint64_t> reading{idle}; //lossy only: first sequence of the visit in progress
+        std::atomic<size_t> lost{0};
+        broadcast_consumer mode = broadcast_consumer::REQUIRED;
+    };
+
+    size_t cap;
+    size_t mask;
+    size_t max_consumers;
+    std::unique_ptr<slot[]> slots;
+    std::unique_ptr<consumer[]> consumers;
+    size_t consumer_count;
+    size_t required_count;
+    size_t lossy_count;
+
+    alignas(64) std::atomic<uint64_t> claim; //next sequence to hand out
+    alignas(64) std::atomic<uint64_t> gate; //cached slowest required cursor (lower bound)
+    alignas(64) std::atomic<bool> closed_flag;
+
+    static size_t round_up(size_t n) {
+        if (n < 2) {
+            throw std::invalid_argument("illegal ring capacity");
+        }
+        size_t c = 1;
+        while (c < n) {
+            c <<= 1;
+        }
+        return c;
+    }
+
+    uint64_t slowest_required() const {
+        uint64_t slowest = idle;
+        for (size_t i = 0; i < consumer_count; i++) {
+            if (consumers[i].mode == broadcast_consumer::REQUIRED) {
+                slowest = std::min(slowest, consumers[i].cursor.load(std::memory_order_acquire));
+            }
+        }
+        return slowest;
+    }
+
+    // true when sequence n would overwrite an item a required consumer has not read yet
+    bool gated(uint64_t n) {
+        if (required_count == 0 || n < cap) {
+            return false;
+        }
+        if (n - gate.load(std::memory_order_relaxed) < cap) {
+            return false;
+        }
+        uint64_t g = slowest_required();
+        gate.store(g, std::memory_order_relaxed);
+        return n - g >= cap;
+    }
+
+    // producer, sequence n claimed: waits for the previous occupant and for lossy visits of it, then publishes
+    void fill(uint64_t n, T &&item) {
+        slot &sl = slots[n & mask];
+        if (n >= cap) {
+            //only another producer can still be writing the previous occupant (required consumers gated it)
+            while (sl.state.load(std::memory_order_acquire) != published(n - cap)) {
+                cpu_relax();
+            }
+        }
+
+        //Dekker with the lossy read marker: either the reader sees writing(n), or we see its marker
+        sl.state.store(writing(n), std::memory_order_seq_cst);
+        if (lossy_count != 0 && n >= cap) {
+            for (size_t i = 0; i < consumer_count; i++) {
+                consumer &c = consumers[i];
+                if (c.mode != broadcast_consumer::LOSSY) {
+                    continue;
+                }
+                uint64_t r;
+                while ((r = c.reading.load(std::memory_order_seq_cst)) != idle && r <= n - cap) {
+                    cpu_relax();
+                }
+            }
+        }
+
+        sl.value = std::move(item);
+        sl.state.store(published(n), std::memory_order_release);
+    }
+
+    template <typename Fn>
+    size_t consume_required(consumer &c, Fn &fn, size_t max_items) {
+        uint64_t cur = c.cursor.load(std::memory_order_relaxed);
+        size_t n = 0;
+        while (n < max_items) {
+            const slot &sl = slots[(cur + n) & mask];
+            if (sl.state.load(std::memory_order_acquire) != published(cur + n)) {
+                break;
+            }
+            fn(static_cast<const T&>(sl.value));
+            n++;
+        }
+        if (n > 0) {
+            c.cursor.store(cur + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    template <typename Fn>
+    size_t consume_lossy(consumer &c, Fn &fn, size_t max_items) {
+        uint64_t cur = c.cursor.load(std::memory_order_relaxed);
+
+        //overrun: skip to the oldest sequence that can still be in the ring
+        uint64_t claimed = claim.load(std::memory_order_acquire);
+        if (claimed > cap && cur < claimed - cap) {
+            c.lost.fetch_add(claimed - cap - cur, std::memory_order_relaxed);
+            cur = claimed - cap;
+        }
+
+        c.reading.store(cur, std::memory_order_seq_cst);
+        size_t n = 0;
+        while (n < max_items) {
+            const slot &sl = slots[(cur + n) & mask];
+            uint64_t st = sl.state.load(std::memory_order_seq_cst);
+            if (st == published(cur + n)) {
+                fn(static_cast<const T&>(sl.value));
+                n++;
+                continue;
+            }
+            if (st > published(cur + n)) {
+                //overwritten since the claim check, count it and retry from the next one on the next call
+                c.lost.fetch_add(1, std::memory_order_relaxed);
+                cur++;
+            }
+            break;
+        }
+        c.reading.store(idle, std::memory_order_release);
+        c.cursor.store(cur + n, std::memory_order_release);
+        return n;
+    }
+
+public:
+    broadcast_ring(size_t capacity, size_t max_consumer_count = 8) : cap(round_up(capacity)), mask(cap - 1), max_consumers(max_consumer_count), slots(new slot[cap]), consumers(new consumer[max_consumer_count]), consumer_count(0), required_count(0), lossy_count(0), claim(0), gate(0), closed_flag(false) {}
+
+    broadcast_ring(const broadcast_ring&) = delete;
+    broadcast_ring& operator=(const broadcast_ring&) = delete;
+
+    // before the first publish, throws std::logic_error otherwise or when max_consumer_count is reached
+    size_t add_consumer(broadcast_consumer mode) {
+        if (claim.load(std::memory_order_relaxed) != 0) {
+            throw std::logic_error("broadcast_ring: consumers must be added before the first publish");
+        }
+        if (consumer_count == max_consumers) {
+            throw std::logic_error("broadcast_ring: too many consumers");
+        }
+        consumers[consumer_count].mode = mode;
+        if (mode == broadcast_consumer::REQUIRED) {
+            required_count++;
+        }
+        else {
+            lossy_count++;
+        }
+        return consumer_count++;
+    }
+
+    // OK, FULL (the slowest required consumer is capacity behind, item untouched) or SHUTDOWN
+    queue_status try_publish(T &&item) {
+        if (closed_flag.load(std::memory_order_relaxed)) {
+            return queue_status::SHUTDOWN;
+        }
+        uint64_t n = claim.load(std::memory_order_relaxed);
+        do {
+            if (gated(n)) {
+                return queue_status::FULL;
+            }
+        } while (!claim.compare_exchange_weak(n, n + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+        fill(n, std::move(item));
+        return queue_status::OK;
+    }
+
+    // waits while FULL (spin, then yield), OK or SHUTDOWN
+    queue_status publish(T &&item) {
+        size_t spins = 0;
+        while (true) {
+            queue_status q_status = try_publish(std::move(item));
+            if (q_status != queue_status::FULL) {
+                return q_status;
+            }
+            if (++spins < 64) {
+                cpu_relax();
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // stage_graph sink helper: publishes (moves) every item, returns how many were published before a SHUTDOWN
+    size_t publish_batch(std::span<T> items) {
+        for (size_t i = 0; i < items.size(); i++) {
+            if (publish(std::move(items[i])) != queue_status::OK) {
+                return i;
+            }
+        }
+        return items.size();
+    }
+
+    // calls fn(const T&) for up to max_items published items in sequence order, returns how many
+    template <typename Fn>
+    size_t consume(size_t id, Fn &&fn, size_t max_items) {
+        consumer &c = consumers[id];
+        return (c.mode == broadcast_consumer::REQUIRED) ? consume_required(c, fn, max_items) : consume_lossy(c, fn, max_items);
+    }
+
+    // producers: no more publishes
+    void close() {
+        closed_flag.store(true, std::memory_order_release);
+    }
+
+    bool closed() const {
+        return closed_flag.load(std::memory_order_acquire);
+    }
+
+    // closed and this consumer read (or skipped) everything
+    bool drained(size_t id) const {
+        return closed() && consumers[id].cursor.load(std::memory_order_relaxed) >= claim.load(std::memory_order_acquire);
+    }
+
+    // items published or in flight, minus what this consumer read
+    size_t lag(size_t id) const {
+        uint64_t claimed = claim.load(std::memory_order_relaxed);
+        uint64_t cur = consumers[id].cursor.load(std::memory_order_relaxed);
+        return (claimed > cur) ? static_cast<size_t>(claimed - cur) : 0;
+    }
+
+    // lossy consumers: items overwritten before they were read
+    size_t lost(size_t id) const { return consumers[id].lost.load(std::memory_order_relaxed); }
+
+    size_t capacity() const { return cap; }
+    uint64_t published_count() const { return claim.load(std::memory_order_relaxed); }
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef _COBS_FRAME_PARSER_H_
+#define _COBS_FRAME_PARSER_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include "delimited_frame_parser.h"
+
+/*
+    COBS (Consistent Overhead Byte Stuffing) framing:
+    frames are separated by 0x00, inside a frame each code byte N is followed by N-1 literal bytes
+    and stands for a 0x00 after them (except code 0xFF and the last block).
+
+    Decoding moves whole literal runs (memmove) instead of copying byte by byte,
+    overhead is at most 1 byte per 254 payload bytes (+1).
+*/
+
+class cobs_frame_parser : public delimited_frame_parser
+{
+private:
+    static constexpr uint8_t delimiter = 0x00;
+
+    static size_t max_encoded_size(const delimited_parser_config &config) {
+        size_t decoded = config.max_payload_len + (config.trailing_crc ? 1 : 0);
+        return decoded + decoded / 254 + 1;
+    }
+
+protected:
+    bool decode(std::vector<uint8_t> &buf) override {
+        size_t n = buf.size();
+        size_t r = 0;
+        size_t w = 0;
+        uint8_t *data = buf.data();
+
+        while (r < n) {
+            uint8_t code = data[r++];
+            if (code == 0) {
+                return false;
+            }
+
+            size_t run = code - 1;
+            if (run > n - r) {
+                return false;
+            }
+
+            std::memmove(data + w, data + r, run);
+            w += run;
+            r += run;
+
+            //implicit zero after the block, except after a full block and at the frame end
+            if (code != 0xFF && r < n) {
+                data[w++] = 0;
+            }
+        }
+
+        buf.resize(w);
+        return true;
+    }
+
+public:
+    cobs_frame_parser(const delimited_parser_config &config = {}) : delimited_frame_parser(delimiter, max_encoded_size(config), config) {
+    }
+};
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef _CPU_RELAX_H_
+#define _CPU_RELAX_H_
+
+/*
+    Spin-wait hint: tells the core we are busy waiting (x86 pause / arm yield).
+    Lowers power and frees pipeline resources for the sibling hyper-thread while spinning.
+*/
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef _CRC8_H_
+#define _CRC8_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+
+/*
+    CRC-8, polynomial 0x07, init 0 (same CRC as the UART SYNC|LEN|PAYLOAD|CRC frames).
+    Table driven: one lookup per byte instead of 8 shift/xor steps.
+*/
+
+namespace crc8 {
+
+    static constexpr uint8_t polynomial = 0x07;
+
+    constexpr std::array<uint8_t, 256> make_table() {
+        std::array<uint8_t, 256> table{};
+        for (size_t i = 0; i < 256; i++) {
+            uint8_t crc = static_cast<uint8_t>(i);
+            for (size_t bit = 0; bit < 8; bit++) {
+                crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ polynomial) : static_cast<uint8_t>(crc << 1);
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+
+    inline constexpr std::array<uint8_t, 256> table = make_table();
+
+    inline uint8_t compute(const uint8_t *data, size_t len, uint8_t crc = 0) {
+        for (size_t i = 0; i < len; i++) {
+            crc = table[crc ^ data[i]];
+        }
+        return crc;
+    }
+}
+
+#endif
@@ -0,0 +1,172 @@
+#ifndef _DELIMITED_FRAME_PARSER_H_
+#define _DELIMITED_FRAME_PARSER_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <deque>
+#include <cassert>
+#include "frame_parser.h"
+#include "crc8.h"
+
+/*
+    Common part of the byte-stuffed framings (COBS, SLIP):
+    frames are separated by a delimiter byte that never appears inside an encoded frame.
+
+    feed_bytes():
+    - the delimiter is located with memchr (glibc memchr is SIMD: SSE2/AVX2/EVEX), whole runs
+      between delimiters are appended with one copy instead of a per-byte state machine
+    - encoded bytes are accumulated directly in the vector that becomes measurement::payload,
+      decode() unstuffs it in place (decoded size <= encoded size) and the vector is moved out
+    - empty frames (back to back delimiters) are skipped, SLIP senders often start with a delimiter
+
+    trailing_crc: the last decoded byte is a CRC-8 (poly 0x07) over the payload, it is checked and removed.
+
+    error_count(): decode errors + CRC failures + oversized frames.
+*/
+
+struct delimited_parser_config {
+    size_t max_payload_len = 256; //bytes, decoded, without CRC
+    bool trailing_crc = false;
+};
+
+class delimited_frame_parser : public frame_parser
+{
+private:
+    static constexpr size_t measurements_buffer_size = 4;
+    uint8_t delimiter;
+    size_t max_encoded_len;
+    bool discarding; //current frame exceeded max_encoded_len, skip until the next delimiter
+    std::vector<uint8_t> pending;
+    std::deque<measurement> measurements_buffer;
+
+    void finish_frame() {
+        if (discarding) {
+            discarding = false;
+            pending.clear();
+            return;
+        }
+
+        if (pending.empty()) {
+            return;
+        }
+
+        if (!decode(pending)) {
+            decode_errors++;
+            pending.clear();
+            return;
+        }
+
+        if (conf.trailing_crc) {
+            if (pending.empty() || crc8::compute(pending.data(), pending.size() - 1) != pending.back()) {
+                crc_errors++;
+                pending.clear();
+                return;
+            }
+            pending.pop_back();
+        }
+
+        if (pending.size() > conf.max_payload_len) {
+            oversize_errors++;
+            pending.clear();
+            return;
+        }
+
+        if (measurements_buffer.size() < measurements_buffer_size) {
+            measurement m;
+            m.payload = std::move(pending);
+            measurements_buffer.push_back(std::move(m));
+        }
+        else {
+            frames_dropped++;
+        }
+        pending.clear();
+        pending.reserve(max_encoded_len);
+    }
+
+    void append_run(const uint8_t *run, size_t len) {
+        if (discarding || len == 0) {
+            return;
+        }
+        if (pending.size() + len > max_encoded_len) {
+            oversize_errors++;
+            discarding = true;
+            pending.clear();
+            return;
+        }
+        pending.insert(pending.end(), run, run + len);
+    }
+
+protected:
+    delimited_parser_config conf;
+    size_t frames_dropped;
+    size_t decode_errors;
+    size_t crc_errors;
+    size_t oversize_errors;
+
+    // decodes buf in place and shrinks it to the decoded size, false on a malformed frame
+    virtual bool decode(std::vector<uint8_t> &buf) = 0;
+
+    delimited_frame_parser(uint8_t delim, size_t max_encoded, const delimited_parser_config &config) : delimiter(delim), max_encoded_len(max_encoded), discarding(false), conf(config), frames_dropped(0), decode_errors(0), crc_errors(0), oversize_errors(0) {
+        pending.reserve(max_encoded_len);
+    }
+
+public:
+    void feed_bytes(const uint8_t *chunk, size_t len) override {
+        const uint8_t *p = chunk;
+        const uint8_t *end = chunk + len;
+
+        while (p < end) {
+            const uint8_t *delim = static_cast<const uint8_t*>(std::memchr(p, delimiter, static_cast<size_t>(end - p)));
+            if (delim == nullptr) {
+                append_run(p, static_cast<size_t>(end - p));
+                return;
+            }
+            append_run(p, static_cast<size_t>(delim - p));
+            finish_frame();
+            p = delim + 1;
+        }
+    }
+
+    // Caller must call has_frame() before extract_frame().
+    measurement extract_frame() override {
+        assert(has_frame());
+        measurement m = std::move(measurements_buffer.front());
+        measurements_buffer.pop_front();
+        return m;
+    }
+
+    bool has_frame() const override {
+        return (measurements_buffer.size() > 0);
+    }
+
+    size_t error_count() const override {
+        return decode_errors + crc_errors + oversize_errors;
+    }
+
+    bool has_capacity() const override {
+        return (measurements_buffer.size() < measurements_buffer_size);
+    }
+
+    const measurement& peek_frame() const override{
+        assert(has_frame());
+        return measurements_buffer.front();
+    }
+
+    void pop_frame() override {
+        assert(has_frame());
+        measurements_buffer.pop_front();
+    }
+
+    size_t scratch_bytes() const override {
+        return (measurements_buffer_size + 1) * max_encoded_len;
+    }
+
+    size_t decode_error_count() const { return decode_errors; }
+    size_t crc_error_count() const { return crc_errors; }
+    size_t oversize_error_count() const { return oversize_errors; }
+    size_t frames_dropped_count() const { return frames_dropped; }
+};
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef _FAKE_FRAME_PARSER_H_
+#define _FAKE_FRAME_PARSER_H_
+
 #include "frame_parser.h"
 #include <cassert>
 
@@ -6,6 +9,7 @@ class fake_frame_parser : public frame_parser {
     private:
     static constexpr size_t frame_size = 8;
     std::vector<uint8_t> buf;
+    mutable measurement peeked; //peek_frame() returns a reference
 
 
     public:
@@ -23,7 +27,7 @@ class fake_frame_parser : public frame_parser {
         assert(has_frame());
         measurement m;
 
-        m.payload.insert(m.payload.end(), buf.begin(), buf.begin() +frame_size);
+        m.payload.assign(buf.begin(), buf.begin() + frame_size);
         buf.erase(buf.begin(), buf.begin() +frame_size);
         return m;
     }
@@ -36,4 +40,21 @@ class fake_frame_parser : public frame_parser {
         return 0;
     }
 
-};
\ No newline at end of file
+    bool has_capacity() const override {
+        return true;
+    }
+
+    const measurement& peek_frame() const override {
+        assert(has_frame());
+        peeked.payload.assign(buf.begin(), buf.begin() + frame_size);
+        return peeked;
+    }
+
+    void pop_frame() override {
+        assert(has_frame());
+        buf.erase(buf.begin(), buf.begin() + frame_size);
+    }
+
+};
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef _FAKE_SENSOR_SOURCE_H_
+#define _FAKE_SENSOR_SOURCE_H_
+
 #include <iostream>
 #include <random>
 #include "sensor_source.h"
@@ -60,3 +63,4 @@ public:
     }
 };
 
+#endif
@@ -81,6 +81,8 @@ public:
     virtual bool has_capacity() const = 0;
     virtual const measurement& peek_frame() const = 0;
     virtual void pop_frame() = 0;
+    // upper bound of the bytes the parser keeps (scratch + buffered frames), used for memory budgeting
+    virtual size_t scratch_bytes() const { return 0; }
 };
 
 #endif
@@ -0,0 +1,107 @@
+#ifndef _FRAME_SCANNER_H_
+#define _FRAME_SCANNER_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include "crc8.h"
+
+/*
+    In place counterpart of frame_parser for the zero-copy path (zero_copy_worker.h).
+
+    frame_parser copies bytes into its own buffers and hands out measurements,
+    a frame_scanner only reports where the payloads are inside the caller's contiguous buffer.
+    It keeps no bytes between calls: scan() returns how many bytes are finished with
+    (frames and garbage), the caller keeps the rest (an incomplete frame) and passes it again
+    together with the next bytes.
+
+    Only framings whose payload is stored unmodified on the wire can be scanned in place
+    (SYNC|LEN|PAYLOAD|CRC), COBS / SLIP need unstuffing and stay on frame_parser.
+*/
+
+class frame_scanner
+{
+public:
+    struct frame_span {
+        size_t offset; //payload offset from buf
+        size_t length;
+    };
+
+    virtual ~frame_scanner() = default;
+
+    // appends the payload of every complete frame in buf[0..len) to out, returns the bytes consumed
+    virtual size_t scan(const uint8_t *buf, size_t len, std::vector<frame_span> &out) = 0;
+
+    // longest frame on the wire (header and CRC included)
+    virtual size_t max_frame_size() const = 0;
+
+    virtual size_t error_count() const = 0;
+};
+
+/*
+    SYNC(0xAA) | LEN | PAYLOAD | CRC-8, same wire format as uart_frame_parser.
+    The sync byte is located with memchr. On a bad length or CRC the scan restarts at the byte after
+    the failed sync (what uart_parser_config::backtrack_resync does, free here since the bytes are
+    still in the buffer). confirm_lock is not supported.
+*/
+class uart_frame_scanner : public frame_scanner
+{
+private:
+    static constexpr uint8_t sync = 0xAA;
+    static constexpr size_t max_payload_len = 64; //bytes
+    static constexpr size_t header_size = 2; //sync + len
+    size_t errors;
+
+public:
+    uart_frame_scanner() : errors(0) {}
+
+    size_t scan(const uint8_t *buf, size_t len, std::vector<frame_span> &out) override {
+        size_t pos = 0;
+
+        while (pos < len) {
+            const uint8_t *s = static_cast<const uint8_t*>(std::memchr(buf + pos, sync, len - pos));
+            if (s == nullptr) {
+                //no sync in the rest, nothing to keep
+                return len;
+            }
+            size_t start = static_cast<size_t>(s - buf);
+            if (start + header_size > len) {
+                return start;
+            }
+
+            size_t payload_len = buf[start + 1];
+            if (payload_len > max_payload_len) {
+                errors++;
+                pos = start + 1;
+                continue;
+            }
+
+            size_t frame_end = start + header_size + payload_len + 1;
+            if (frame_end > len) {
+                //incomplete frame, keep it
+                return start;
+            }
+
+            if (crc8::compute(buf + start + header_size, payload_len) != buf[frame_end - 1]) {
+                errors++;
+                pos = start + 1;
+                continue;
+            }
+
+            out.push_back(frame_span{start + header_size, payload_len});
+            pos = frame_end;
+        }
+        return pos;
+    }
+
+    size_t max_frame_size() const override {
+        return header_size + max_payload_len + 1;
+    }
+
+    size_t error_count() const override {
+        return errors;
+    }
+};
+
+#endif
@@ -0,0 +1,399 @@
+#ifndef _HISTORY_STORE_H_
+#define _HISTORY_STORE_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <span>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include "measurement.h"
+
+/*
+    Bounded in-memory time series per sensor ("last 10 seconds of sensor X").
+
+    Fed by one ingest thread, typically the consumer or a stage_graph sink:
+        graph->add_sink("history", [&](std::span<measurement> b) { for (auto &m : b) history.append(m); });
+    Queried from any thread with range() / latest_n().
+
+    Storage: per sensor a list of fixed size chunks, the last one is being appended to.
+    Samples are byte aligned so a reader can decode a chunk while the writer appends to it:
+        varint   payload length
+        varint   zigzag(delta of delta) of the timestamp (ns), first sample relative to the chunk start
+        varint   zigzag(sequence delta - 1)
+        bitmap   one bit per payload byte, set when the byte differs from the previous sample
+        bytes    the differing bytes of (payload XOR previous payload), previous = zeros when the length changed
+    A slowly changing sensor with regular timestamps costs a few bytes per sample.
+
+    Concurrency (ingestion never waits for a query):
+    - the bytes of a sample are written first, then the chunk sample count is published (release),
+      readers decode exactly count samples (acquire), bytes below it never change again
+    - the chunk list of a sensor is copy-on-write, replaced when a chunk is added / evicted, readers only
+      copy the list pointer under a per-sensor mutex (no decoding under the lock)
+    - an evicted chunk stays alive until the last reader that copied it is done
+
+    Time index: every chunk keeps min / max timestamp, range() skips the chunks outside [t0, t1].
+
+    Memory cap: chunk memory over all sensors. When a new chunk would exceed it the chunk with the oldest
+    max timestamp (over every sensor, never an active chunk) is evicted. The cap must hold two chunks
+    per sensor.
+
+    Sensors with an id >= max_sensors and payloads that cannot fit in a chunk are rejected (counted).
+*/
+
+struct history_config {
+    size_t max_sensors = 64;
+    size_t chunk_bytes = 4096; //encoded bytes per chunk
+    size_t memory_cap_bytes = 16 * 1024 * 1024; //chunk memory over all sensors
+};
+
+struct history_stats {
+    size_t samples = 0; //currently stored
+    size_t chunks = 0;
+    size_t encoded_bytes = 0; //bytes used by the stored samples
+    size_t reserved_bytes = 0; //chunk memory (capacity)
+    size_t evicted_chunks = 0;
+    size_t rejected = 0;
+
+    double bytes_per_sample() const {
+        return (samples != 0) ? static_cast<double>(encoded_bytes) / static_cast<double>(samples) : 0.0;
+    }
+};
+
+class history_store
+{
+private:
+    static constexpr size_t max_varint_bytes = 10;
+
+    struct chunk {
+        std::unique_ptr<uint8_t[]> data;
+        size_t capacity;
+        int64_t start_ts; //ns, base of the first delta
+        size_t start_seq;
+        std::atomic<size_t> count{0}; //published samples
+        std::atomic<size_t> used{0}; //published bytes
+        std::atomic<int64_t> min_ts{std::numeric_limits<int64_t>::max()};
+        std::atomic<int64_t> max_ts{std::numeric_limits<int64_t>::min()};
+
+        chunk(size_t cap, int64_t ts, size_t seq) : data(new uint8_t[cap]), capacity(cap), start_ts(ts), start_seq(seq) {}
+    };
+
+    using chunk_list = std::vector<std::shared_ptr<chunk>>;
+
+    //encoder state, only the ingest thread touches it
+    struct writer_state {
+        chunk *active = nullptr;
+        size_t pos = 0;
+        int64_t prev_ts = 0;
+        int64_t prev_delta = 0;
+        size_t prev_seq = 0;
+        std::vector<uint8_t> prev_payload;
+    };
+
+    struct series {
+        mutable std::mutex list_mtx; //guards the list pointer only
+        std::shared_ptr<const chunk_list> list = std::make_shared<const chunk_list>();
+        writer_state w;
+    };
+
+    history_config conf;
+    std::unique_ptr<series[]> sensors;
+    std::atomic<size_t> reserved;
+    std::atomic<size_t> evicted;
+    std::atomic<size_t> rejected;
+
+    static int64_t to_ns(std::chrono::steady_clock::time_point t) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+    }
+
+    static std::chrono::steady_clock::time_point from_ns(int64_t ns) {
+        return std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(ns)));
+    }
+
+    static uint64_t zigzag(int64_t v) {
+        return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    }
+
+    static int64_t unzigzag(uint64_t v) {
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+    static size_t put_varint(uint8_t *p, uint64_t v) {
+        size_t n = 0;
+        while (v >= 0x80) {
+            p[n++] = static_cast<uint8_t>(v | 0x80);
+            v >>= 7;
+        }
+        p[n++] = static_cast<uint8_t>(v);
+        return n;
+    }
+
+    static uint64_t get_varint(const uint8_t *&p) {
+        uint64_t v = 0;
+        int shift = 0;
+        while (*p & 0x80) {
+            v |= static_cast<uint64_t>(*p++ & 0x7F) << shift;
+            shift += 7;
+        }
+        v |= static_cast<uint64_t>(*p++) << shift;
+        return v;
+    }
+
+    static size_t worst_case_bytes(size_t payload_len) {
+        return 3 * max_varint_bytes + (payload_len + 7) / 8 + payload_len;
+    }
+
+    std::shared_ptr<const chunk_list> load_list(const series &s) const {
+        std::lock_guard<std::mutex> lock(s.list_mtx);
+        return s.list;
+    }
+
+    void store_list(series &s, std::shared_ptr<const chunk_list> l) {
+        std::lock_guard<std::mutex> lock(s.list_mtx);
+        s.list = std::move(l);
+    }
+
+    // drops the sealed chunk with the oldest data over all sensors, false when there is none
+    bool evict_oldest() {
+        series *victim = nullptr;
+        int64_t oldest = std::numeric_limits<int64_t>::max();
+        for (size_t i = 0; i < conf.max_sensors; i++) {
+            const chunk_list &l = *sensors[i].list; //only the ingest thread replaces lists
+            if (l.size() < 2) {
+                continue; //a lone chunk is the active one
+            }
+            int64_t ts = l.front()->max_ts.load(std::memory_order_relaxed);
+            if (victim == nullptr || ts < oldest) {
+                victim = &sensors[i];
+                oldest = ts;
+            }
+        }
+        if (victim == nullptr) {
+            return false;
+        }
+
+        auto next = std::make_shared<chunk_list>(victim->list->begin() + 1, victim->list->end());
+        reserved.fetch_sub(victim->list->front()->capacity, std::memory_order_relaxed);
+        store_list(*victim, std::move(next));
+        evicted.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void start_chunk(series &s, int64_t ts, size_t seq) {
+        while (reserved.load(std::memory_order_relaxed) + conf.chunk_bytes > conf.memory_cap_bytes && evict_oldest()) {
+        }
+
+        auto c = std::make_shared<chunk>(conf.chunk_bytes, ts, seq);
+        reserved.fetch_add(conf.chunk_bytes, std::memory_order_relaxed);
+
+        auto next = std::make_shared<chunk_list>(*s.list);
+        next->push_back(c);
+        store_list(s, std::move(next));
+
+        s.w.active = c.get();
+        s.w.pos = 0;
+        s.w.prev_ts = ts;
+        s.w.prev_delta = 0;
+        s.w.prev_seq = seq - 1;
+        s.w.prev_payload.clear();
+    }
+
+    // decodes the published samples of c, calls fn(measurement&&) for each
+    template <typename Fn>
+    static void decode(const chunk &c, size_t sensor_id, Fn &&fn) {
+        size_t n = c.count.load(std::memory_order_acquire);
+        const uint8_t *p = c.data.get();
+        int64_t prev_ts = c.start_ts;
+        int64_t prev_delta = 0;
+        size_t prev_seq = c.start_seq - 1;
+        std::vector<uint8_t> prev_payload;
+
+        for (size_t i = 0; i < n; i++) {
+            size_t len = static_cast<size_t>(get_varint(p));
+            int64_t delta = prev_delta + unzigzag(get_varint(p));
+            int64_t ts = prev_ts + delta;
+            size_t seq = prev_seq + 1 + static_cast<size_t>(unzigzag(get_varint(p)));
+
+            measurement m;
+            m.payload.assign(len, 0);
+            if (prev_payload.size() == len) {
+                m.payload = prev_payload;
+            }
+            const uint8_t *bitmap = p;
+            p += (len + 7) / 8;
+            for (size_t b = 0; b < len; b++) {
+                if (bitmap[b / 8] & (1u << (b % 8))) {
+                    m.payload[b] ^= *p++;
+                }
+            }
+
+            m.system_timestamp = from_ns(ts);
+            m.sensor_id = sensor_id;
+            m.sequence_number = seq;
+            prev_payload = m.payload;
+            prev_ts = ts;
+            prev_delta = delta;
+            prev_seq = seq;
+            fn(std::move(m));
+        }
+    }
+
+public:
+    history_store(const history_config &config = {}) : conf(config), sensors(new series[config.max_sensors]), reserved(0), evicted(0), rejected(0) {
+        if (conf.max_sensors == 0 || conf.chunk_bytes < worst_case_bytes(0) || conf.memory_cap_bytes < 2 * conf.max_sensors * conf.chunk_bytes) {
+            throw std::invalid_argument("illegal history configuration");
+        }
+    }
+
+    history_store(const history_store&) = delete;
+    history_store& operator=(const history_store&) = delete;
+
+    // ingest thread only, false when the sample was rejected
+    bool append(const measurement &meas) {
+        size_t len = meas.payload.size();
+        if (meas.sensor_id >= conf.max_sensors || worst_case_bytes(len) > conf.chunk_bytes) {
+            rejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        series &s = sensors[meas.sensor_id];
+        int64_t ts = to_ns(meas.system_timestamp);
+        if (s.w.active == nullptr || s.w.pos + worst_case_bytes(len) > s.w.active->capacity) {
+            start_chunk(s, ts, meas.sequence_number);
+        }
+
+        writer_state &w = s.w;
+        chunk &c = *w.active;
+        uint8_t *p = c.data.get() + w.pos;
+        size_t n = 0;
+
+        int64_t delta = ts - w.prev_ts;
+        n += put_varint(p + n, len);
+        n += put_varint(p + n, zigzag(delta - w.prev_delta));
+        n += put_varint(p + n, zigzag(static_cast<int64_t>(meas.sequence_number - w.prev_seq - 1)));
+
+        if (w.prev_payload.size() != len) {
+            w.prev_payload.assign(len, 0);
+        }
+        uint8_t *bitmap = p + n;
+        size_t bitmap_bytes = (len + 7) / 8;
+        std::memset(bitmap, 0, bitmap_bytes);
+        n += bitmap_bytes;
+        for (size_t b = 0; b < len; b++) {
+            uint8_t x = meas.payload[b] ^ w.prev_payload[b];
+            if (x != 0) {
+                bitmap[b / 8] |= static_cast<uint8_t>(1u << (b % 8));
+                p[n++] = x;
+            }
+        }
+
+        w.pos += n;
+        w.prev_ts = ts;
+        w.prev_delta = delta;
+        w.prev_seq = meas.sequence_number;
+        std::memcpy(w.prev_payload.data(), meas.payload.data(), len);
+
+        if (ts < c.min_ts.load(std::memory_order_relaxed)) {
+            c.min_ts.store(ts, std::memory_order_relaxed);
+        }
+        if (ts > c.max_ts.load(std::memory_order_relaxed)) {
+            c.max_ts.store(ts, std::memory_order_relaxed);
+        }
+        c.used.store(w.pos, std::memory_order_relaxed);
+        c.count.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+    /*
+        Appends the samples of sensor_id with t0 <= timestamp <= t1 to out, oldest first.
+        Returns the number of samples appended. Any thread.
+    */
+    size_t range(size_t sensor_id, std::chrono::steady_clock::time_point t0, std::chrono::steady_clock::time_point t1, std::vector<measurement> &out) const {
+        if (sensor_id >= conf.max_sensors) {
+            return 0;
+        }
+        int64_t lo = to_ns(t0);
+        int64_t hi = to_ns(t1);
+        size_t before = out.size();
+
+        auto list = load_list(sensors[sensor_id]);
+        for (const auto &c : *list) {
+            //min / max are published before the count, a chunk with samples always has a valid range
+            if (c->count.load(std::memory_order_acquire) == 0 || c->max_ts.load(std::memory_order_relaxed) < lo || c->min_ts.load(std::memory_order_relaxed) > hi) {
+                continue;
+            }
+            decode(*c, sensor_id, [&](measurement &&m) {
+                int64_t ts = to_ns(m.system_timestamp);
+                if (ts >= lo && ts <= hi) {
+                    out.push_back(std::move(m));
+                }
+            });
+        }
+        return out.size() - before;
+    }
+
+    /*
+        Appends the newest n samples of sensor_id to out, oldest first.
+        Returns the number of samples appended (< n when the history is shorter). Any thread.
+    */
+    size_t latest_n(size_t sensor_id, size_t n, std::vector<measurement> &out) const {
+        if (sensor_id >= conf.max_sensors || n == 0) {
+            return 0;
+        }
+        auto list = load_list(sensors[sensor_id]);
+
+        //walk back until the chunks hold n samples, then decode forward
+        size_t first = list->size();
+        size_t available = 0;
+        std::vector<size_t> counts(list->size());
+        while (first > 0 && available < n) {
+            first--;
+            counts[first] = (*list)[first]->count.load(std::memory_order_acquire);
+            available += counts[first];
+        }
+
+        size_t skip = (available > n) ? available - n : 0;
+        size_t before = out.size();
+        for (size_t i = first; i < list->size(); i++) {
+            size_t taken = 0;
+            decode(*(*list)[i], sensor_id, [&](measurement &&m) {
+                //samples published after counts[] was read are left out, the result stays n long
+                if (taken++ >= counts[i]) {
+                    return;
+                }
+                if (skip > 0) {
+                    skip--;
+                    return;
+                }
+                out.push_back(std::move(m));
+            });
+        }
+        return out.size() - before;
+    }
+
+    history_stats stats() const {
+        history_stats st;
+        for (size_t i = 0; i < conf.max_sensors; i++) {
+            auto list = load_list(sensors[i]);
+            st.chunks += list->size();
+            for (const auto &c : *list) {
+                st.samples += c->count.load(std::memory_order_acquire);
+                st.encoded_bytes += c->used.load(std::memory_order_relaxed);
+            }
+        }
+        st.reserved_bytes = reserved.load(std::memory_order_relaxed);
+        st.evicted_chunks = evicted.load(std::memory_order_relaxed);
+        st.rejected = rejected.load(std::memory_order_relaxed);
+        return st;
+    }
+
+    const history_config& config() const { return conf; }
+};
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef _LATEST_VALUE_TABLE_H_
+#define _LATEST_VALUE_TABLE_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <span>
+#include <stdexcept>
+#include "measurement.h"
+#include "cpu_relax.h"
+
+/*
+    Newest measurement of every sensor, indexed by sensor_id, for dashboards and control loops.
+
+    The workers update it next to the global queue push, readers never touch the queue,
+    so any number of them can poll it without competing with the main consumer.
+
+    Every entry is protected by its own seqlock:
+    - writer (one per sensor_id, its worker): seq odd -> write payload words -> seq even
+    - reader: seq (even) -> copy words -> seq again, the copy is good when both are equal
+    Readers write nothing shared (no cache line ping-pong with the writer), the payload is stored as
+    relaxed atomic words so a torn copy is only discarded, never undefined behaviour.
+
+    Readers retry a torn copy at most max_read_attempts times and then report failure
+    (counted in contended_reads()), so a read is bounded even under a very fast writer.
+
+    snapshot(): consistent cut across several sensors. All seqs are read, all entries copied, then every
+    seq is checked again. If none changed, every copied value was current at the same instant
+    (between the two seq passes).
+
+    Payloads longer than max_payload_bytes are not stored (counted in oversize_count()).
+*/
+
+struct latest_value {
+    std::vector<uint8_t> payload;
+    std::chrono::steady_clock::time_point system_timestamp{};
+    size_t sequence_number = 0;
+    uint64_t version = 0; //updates of this sensor so far, 0 => never written
+};
+
+class latest_value_table
+{
+private:
+    static constexpr size_t max_read_attempts = 64;
+    static constexpr size_t words_per_line = 8;
+
+    //entry layout in words: seq | timestamp ns | sequence number | length | payload...
+    static constexpr size_t seq_word = 0;
+    static constexpr size_t ts_word = 1;
+    static constexpr size_t seqno_word = 2;
+    static constexpr size_t len_word = 3;
+    static constexpr size_t header_words = 4;
+
+    struct alignas(64) line {
+        std::atomic<uint64_t> w[words_per_line];
+    };
+
+    size_t entries;
+    size_t max_payload;
+    size_t lines_per_entry;
+    std::unique_ptr<line[]> lines;
+    std::atomic<size_t> oversize;
+    mutable std::atomic<size_t> contended;
+
+    std::atomic<uint64_t>& word(size_t sensor_id, size_t idx) const {
+        return lines[sensor_id * lines_per_entry + idx / words_per_line].w[idx % words_per_line];
+    }
+
+    // payload copy between two seq loads, the caller validates the seqs
+    void copy_entry(size_t sensor_id, uint64_t seq, latest_value &out) const {
+        size_t len = static_cast<size_t>(word(sensor_id, len_word).load(std::memory_order_relaxed));
+        len = std::min(len, max_payload); //torn length, the copy is discarded anyway
+        out.payload.resize(len);
+        for (size_t off = 0; off < len; off += sizeof(uint64_t)) {
+            uint64_t v = word(sensor_id, header_words + off / sizeof(uint64_t)).load(std::memory_order_relaxed);
+            std::memcpy(out.payload.data() + off, &v, std::min(sizeof(uint64_t), len - off));
+        }
+        int64_t ts_ns = static_cast<int64_t>(word(sensor_id, ts_word).load(std::memory_order_relaxed));
+        out.system_timestamp = std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(ts_ns)));
+        out.sequence_number = static_cast<size_t>(word(sensor_id, seqno_word).load(std::memory_order_relaxed));
+        out.version = seq / 2;
+    }
+
+public:
+    latest_value_table(size_t max_sensors, size_t max_payload_bytes = 64) : entries(max_sensors), max_payload(max_payload_bytes), oversize(0), contended(0) {
+        if (max_sensors == 0 || max_payload_bytes == 0) {
+            throw std::invalid_argument("illegal latest value table size");
+        }
+        size_t words = header_words + (max_payload_bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+        lines_per_entry = (words + words_per_line - 1) / words_per_line;
+        lines.reset(new line[entries * lines_per_entry]);
+        for (size_t i = 0; i < entries * lines_per_entry; i++) {
+            for (auto &w : lines[i].w) {
+                w.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    latest_value_table(const latest_value_table&) = delete;
+    latest_value_table& operator=(const latest_value_table&) = delete;
+
+    // writer side, at most one thread per sensor_id
+    bool update(size_t sensor_id, const uint8_t *data, size_t len, std::chrono::steady_clock::time_point ts, size_t sequence_number) {
+        if (sensor_id >= entries) {
+            return false;
+        }
+        if (len > max_payload) {
+            oversize.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        std::atomic<uint64_t> &seq = word(sensor_id, seq_word);
+        uint64_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        word(sensor_id, ts_word).store(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(ts.time_since_epoch()).count()), std::memory_order_relaxed);
+        word(sensor_id, seqno_word).store(sequence_number, std::memory_order_relaxed);
+        word(sensor_id, len_word).store(len, std::memory_order_relaxed);
+        for (size_t off = 0; off < len; off += sizeof(uint64_t)) {
+            uint64_t v = 0;
+            std::memcpy(&v, data + off, std::min(sizeof(uint64_t), len - off));
+            word(sensor_id, header_words + off / sizeof(uint64_t)).store(v, std::memory_order_relaxed);
+        }
+
+        seq.store(s + 2, std::memory_order_release);
+        return true;
+    }
+
+    bool update(size_t sensor_id, const measurement &meas) {
+        return update(sensor_id, meas.payload.data(), meas.payload.size(), meas.system_timestamp, meas.sequence_number);
+    }
+
+    /*
+        Reader side, any thread.
+        false: sensor_id out of range, never written, or max_read_attempts torn copies in a row.
+    */
+    bool read(size_t sensor_id, latest_value &out) const {
+        if (sensor_id >= entries) {
+            return false;
+        }
+        const std::atomic<uint64_t> &seq = word(sensor_id, seq_word);
+
+        for (size_t attempt = 0; attempt < max_read_attempts; attempt++) {
+            uint64_t s1 = seq.load(std::memory_order_acquire);
+            if (s1 == 0) {
+                return false;
+            }
+            if (s1 & 1) {
+                cpu_relax(); //write in progress
+                continue;
+            }
+            copy_entry(sensor_id, s1, out);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq.load(std::memory_order_relaxed) == s1) {
+                return true;
+            }
+            cpu_relax();
+        }
+        contended.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /*
+        Consistent cut over sensor_ids, out[i] belongs to sensor_ids[i] (version 0 => never written).
+        false: an id out of range, or max_read_attempts tries where one of the entries changed meanwhile.
+    */
+    bool snapshot(std::span<const size_t> sensor_ids, std::vector<latest_value> &out) const {
+        out.resize(sensor_ids.size());
+        std::vector<uint64_t> seqs(sensor_ids.size());
+        for (size_t id : sensor_ids) {
+            if (id >= entries) {
+                return false;
+            }
+        }
+
+        for (size_t attempt = 0; attempt < max_read_attempts; attempt++) {
+            bool busy = false;
+            for (size_t i = 0; i < sensor_ids.size() && !busy; i++) {
+                seqs[i] = word(sensor_ids[i], seq_word).load(std::memory_order_acquire);
+                busy = (seqs[i] & 1) != 0;
+            }
+            if (busy) {
+                cpu_relax();
+                continue;
+            }
+
+            for (size_t i = 0; i < sensor_ids.size(); i++) {
+                copy_entry(sensor_ids[i], seqs[i], out[i]);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            bool changed = false;
+            for (size_t i = 0; i < sensor_ids.size() && !changed; i++) {
+                changed = word(sensor_ids[i], seq_word).load(std::memory_order_relaxed) != seqs[i];
+            }
+            if (!changed) {
+                return true;
+            }
+            cpu_relax();
+        }
+        contended.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    size_t capacity() const { return entries; }
+    size_t max_payload_bytes() const { return max_payload; }
+    size_t memory_bytes() const { return entries * lines_per_entry * sizeof(line); }
+
+    // updates rejected because the payload did not fit in an entry
+    size_t oversize_count() const { return oversize.load(std::memory_order_relaxed); }
+
+    // reads / snapshots that gave up after max_read_attempts torn copies
+    size_t contended_reads() const { return contended.load(std::memory_order_relaxed); }
+};
+
+#endif
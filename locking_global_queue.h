@@ -1,5 +1,5 @@
-#ifndef _GLOBAL_QUEUE_H_
-#define _GLOBAL_QUEUE_H_
+#ifndef _LOCKING_GLOBAL_QUEUE_H_
+#define _LOCKING_GLOBAL_QUEUE_H_
 
 #include <cstdint>
 #include <cstddef>
@@ -8,6 +8,9 @@
 #include <condition_variable>
 #include <stdexcept> 
 #include "measurement.h"
+#include "memory_policy.h"
+#include "queue_concept.h"
+#include "queue_space_notifier.h"
 
 /*
     This class is suited for MPSC
@@ -20,13 +23,16 @@
     Under heavy contention, convoying and context switches kill throughput.
     Boundedness is trivial; linearizability is trivial; lock-freedom is not.
 
+    Kept as the reference backend of global_queue_backend (queue_concept.h), same contract as
+    lockless_global_queue: push() returns FULL instead of overwriting, pop() does not block.
+    Unlike the lockless queue, items pushed before shutdown() can still be popped (wait_pop / pop drain first).
 */
 
 template <typename T>
-class global_queue
+class locking_global_queue
 {
 private:
-    std::vector<T> vec;
+    std::vector<T, policy_allocator<T>> vec;
     size_t read;
     size_t write;
     size_t total_capacity;
@@ -34,6 +40,7 @@ private:
     std::mutex m;
     std::condition_variable cv;
     bool shut_down;
+    queue_space_notifier space;
     void advanced_read() {
         read = (read == (total_capacity -1)) ? 0 : read +1;
     }
@@ -43,8 +50,11 @@ private:
     }
 
 public:
-    // capacity must be larger then 0
-    global_queue(size_t capacity): read(0), write(0), total_capacity(capacity), current_size(0), shut_down(false) {
+    using value_type = T;
+
+    // capacity must be at least 2
+    // policy: NUMA node / huge pages for the slot array (see memory_policy.h)
+    locking_global_queue(size_t capacity, const memory_policy &policy = {}): vec(policy_allocator<T>(policy)), read(0), write(0), total_capacity(capacity), current_size(0), shut_down(false), space(capacity) {
 
         if (capacity == 0) {
             throw std::invalid_argument("illegal capacity value");
@@ -53,10 +63,21 @@ public:
         vec.resize(capacity);
     }
 
-    ~global_queue() = default;
+    ~locking_global_queue() = default;
 
     size_t capacity() const { return total_capacity;}
 
+    // bytes per slot (payload heap memory not included)
+    static constexpr size_t slot_bytes() { return sizeof(T); }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(m);
+        return current_size;
+    }
+
+    // producers waiting for space after FULL (queue_space_notifier.h)
+    queue_space_notifier& space_notifier() { return space; }
+
     /*
         “After calling push, the passed measurement object must not be used.”
         Call site                 What happens:
@@ -65,29 +86,27 @@ public:
         push(m)	                  => copy
         push(const m)             => copy
     */
-    bool push(T new_meas) {
+    queue_status push(T new_meas) {
         std::unique_lock<std::mutex> lock(m);
         if (shut_down) {
-            return false;
+            return queue_status::SHUTDOWN;
+        }
+        if (current_size == total_capacity) {
+            return queue_status::FULL;
         }
 
         //push to buffer
         vec[write] = std::move(new_meas);
-        if (current_size == total_capacity) {
-            advanced_read();
-        }
         advanced_write();
-        if (current_size < total_capacity) {
-            current_size++;
-        }
+        current_size++;
         
         lock.unlock();
         cv.notify_one();
-        return true;
+        return queue_status::OK;
     }
 
-    //blocking consumer function
-    bool pop(T &meas) {   
+    //blocking consumer function, SHUTDOWN once the queue is shut down and empty
+    queue_status wait_pop(T &meas) {   
         std::unique_lock<std::mutex> lock(m);
 
         // this line cv.wait(lock, predicate) is the “safe” overload, its equivlent to:
@@ -97,39 +116,46 @@ public:
         cv.wait(lock, [this]{return (shut_down || current_size != 0);}); 
 
         if (shut_down && current_size == 0) {
-            return false;
+            return queue_status::SHUTDOWN;
         }
 
         //pop from buffer
-        meas = vec[read];
+        meas = std::move(vec[read]);
         advanced_read();
         current_size--;
+        size_t left = current_size;
 
-        return true;
+        lock.unlock();
+        space.consumed([left] { return left; });
+        return queue_status::OK;
     }
 
     //non blocking consumer function
-    bool try_pop(T &meas) {
+    queue_status pop(T &meas) {
         std::unique_lock<std::mutex> lock(m);
 
         if (current_size == 0) {
-            return false;
+            return shut_down ? queue_status::SHUTDOWN : queue_status::EMPTY;
         } 
 
-        meas = vec[read];
+        meas = std::move(vec[read]);
         advanced_read();
         current_size--;
+        size_t left = current_size;
 
-        return true;
+        lock.unlock();
+        space.consumed([left] { return left; });
+        return queue_status::OK;
     }
 
     void shutdown() {
 
-        if (shut_down) return;
         std::unique_lock<std::mutex> lock(m);
+        if (shut_down) return;
         shut_down = true;
         lock.unlock();
         cv.notify_all();
+        space.notify_all();
     }
 };
 
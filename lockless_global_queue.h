@@ -6,7 +6,17 @@
 #include <atomic>
 #include <stdexcept>
 #include <memory>
+#include <array>
+#include <algorithm>
+#ifdef GLOBAL_QUEUE_STATS
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
 #include "measurement.h"
+#include "memory_policy.h"
+#include "queue_concept.h"
+#include "queue_space_notifier.h"
 
 /*
 alignas(64):
@@ -26,44 +36,146 @@ memory order:
     “ordering is via seq acquire/release”.
 */
 
-enum class queue_status{ OK, FULL, EMPTY, SHUTDOWN };
+/*
+    Contention counters, compiled in only with -DGLOBAL_QUEUE_STATS (all zero otherwise).
+
+    Every thread counts into its own cache line aligned block (registered on its first operation),
+    so the counters do not add contention of their own. stats() sums the blocks, it can be called
+    from any thread while the queue is in use (values are a racy snapshot).
+
+    write_cas_failures  : producer lost the CAS on write to another producer
+    producer_slot_spins : push saw diff > 0 (write index is stale, the slot was already claimed)
+    read_cas_failures   : consumer lost the CAS on read
+    consumer_slot_spins : pop saw diff > 0 (slot claimed by a producer that has not published yet)
+    occupancy_high_water: max items in the queue seen right after a successful push
+                          (costs one extra load of the read index per push when enabled)
+*/
+struct queue_stats {
+    uint64_t push_ok = 0;
+    uint64_t push_full = 0;
+    uint64_t write_cas_failures = 0;
+    uint64_t producer_slot_spins = 0;
+    uint64_t pop_ok = 0;
+    uint64_t pop_empty = 0;
+    uint64_t read_cas_failures = 0;
+    uint64_t consumer_slot_spins = 0;
+    uint64_t occupancy_high_water = 0;
+};
 
 template <typename T>
-class global_queue
+class lockless_global_queue
 {
 private:
 
-    typedef struct {
+    // one slot per cache line (or more), a producer publishing slot i does not invalidate the line of slot i+1
+    struct alignas(64) slot {
         std::atomic<uint64_t> seq;
         T data;
-    } slot;
+    };
 
-    std::unique_ptr<slot[]> vec;
+    policy_array<slot> vec;
     alignas(64) std::atomic<uint64_t> read;
     alignas(64) std::atomic<uint64_t> write;
     size_t total_capacity; // must be a power of 2
     size_t mask;
     std::atomic<bool> shut_down;
-    
-public:
-    // capacity must be larger then 0
-    global_queue(size_t capacity): read(0), write(0), total_capacity(capacity), mask(capacity -1), shut_down(false) {
+    queue_space_notifier space;
+
+    enum stat_counter { PUSH_OK, PUSH_FULL, WRITE_CAS_FAIL, PRODUCER_SLOT_SPIN, POP_OK, POP_EMPTY, READ_CAS_FAIL, CONSUMER_SLOT_SPIN, OCCUPANCY_HWM, STAT_COUNT };
+
+#ifdef GLOBAL_QUEUE_STATS
+    struct alignas(64) stats_block {
+        std::thread::id owner;
+        std::array<std::atomic<uint64_t>, STAT_COUNT> counters{};
+    };
 
+    uint64_t instance_id;
+    std::mutex stats_mtx;
+    std::vector<std::unique_ptr<stats_block>> stats_blocks;
+
+    static uint64_t next_instance_id() {
+        static std::atomic<uint64_t> id{0};
+        return id.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    stats_block& local_stats() {
+        //one cached block per thread, looked up again only when the thread switches queue
+        thread_local uint64_t cached_id = 0;
+        thread_local stats_block *cached_block = nullptr;
+        if (cached_id != instance_id) {
+            std::lock_guard<std::mutex> lock(stats_mtx);
+            std::thread::id self = std::this_thread::get_id();
+            auto it = std::find_if(stats_blocks.begin(), stats_blocks.end(), [&](const auto &b) { return b->owner == self; });
+            if (it == stats_blocks.end()) {
+                stats_blocks.push_back(std::make_unique<stats_block>());
+                stats_blocks.back()->owner = self;
+                it = stats_blocks.end() - 1;
+            }
+            cached_block = it->get();
+            cached_id = instance_id;
+        }
+        return *cached_block;
+    }
+#endif
+
+    void count([[maybe_unused]] stat_counter c) {
+#ifdef GLOBAL_QUEUE_STATS
+        //owner thread is the only writer, no RMW needed
+        auto &counter = local_stats().counters[c];
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+#endif
+    }
+
+    void record_occupancy([[maybe_unused]] uint64_t write_pos) {
+#ifdef GLOBAL_QUEUE_STATS
+        uint64_t occupancy = write_pos - std::min(write_pos, read.load(std::memory_order_relaxed));
+        auto &hwm = local_stats().counters[OCCUPANCY_HWM];
+        if (occupancy > hwm.load(std::memory_order_relaxed)) {
+            hwm.store(occupancy, std::memory_order_relaxed);
+        }
+#endif
+    }
+
+    static size_t validated_capacity(size_t capacity) {
         if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
             throw std::invalid_argument("illegal capacity value");
         }
+        return capacity;
+    }
+    
+public:
+    // capacity must be a power of 2, at least 2
+    // policy: NUMA node / huge pages for the slot array (see memory_policy.h)
+    using value_type = T;
 
-        vec = (std::make_unique<slot[]>(total_capacity));
+    lockless_global_queue(size_t capacity, const memory_policy &policy = {}): vec(validated_capacity(capacity), policy), read(0), write(0), total_capacity(capacity), mask(capacity -1), shut_down(false), space(capacity) {
+#ifdef GLOBAL_QUEUE_STATS
+        instance_id = next_instance_id();
+#endif
 
+        //with vec's constructors this writes every slot: an unbound slot array is placed on this thread's node
         for (size_t i = 0; i < total_capacity; i++) {
             vec[i].seq.store(i, std::memory_order_relaxed);
         }
     }
 
-    ~global_queue() = default;
+    ~lockless_global_queue() = default;
 
     size_t capacity() const { return total_capacity;}
 
+    // bytes per slot (payload heap memory not included)
+    static constexpr size_t slot_bytes() { return sizeof(slot); }
+
+    // approximate (claimed, not necessarily published / released slots)
+    size_t size() const {
+        uint64_t r = read.load(std::memory_order_relaxed);
+        uint64_t w = write.load(std::memory_order_relaxed);
+        return static_cast<size_t>(w - std::min(w, r));
+    }
+
+    // producers waiting for space after FULL (queue_space_notifier.h)
+    queue_space_notifier& space_notifier() { return space; }
+
     /*
         “After calling push, the passed measurement object must not be used.”
         Call site                 What happens:
@@ -94,18 +206,23 @@ public:
                     break;
                 }
                 //slot accupied, try again
+                count(WRITE_CAS_FAIL);
             }
             else if(diff < 0) {
                 //queue is full
+                count(PUSH_FULL);
                 return queue_status::FULL;
             }
             else {
                 //slot is being used by producer, try again
+                count(PRODUCER_SLOT_SPIN);
             }
         }
 
         s->data = std::move(new_meas);
         s->seq.store(p + 1, std::memory_order_release);        
+        count(PUSH_OK);
+        record_occupancy(p + 1);
         return queue_status::OK;
     }
 
@@ -133,26 +250,60 @@ public:
                 } 
                 else {
                     //slot is being used by consumer, try again to claim a slot
+                    count(READ_CAS_FAIL);
                 }
             }
             else if(diff < 0) {
                 //queue is empty
+                count(POP_EMPTY);
                 return queue_status::EMPTY;
             }
             else {
                 //slot is being used by producer, try again
+                count(CONSUMER_SLOT_SPIN);
             }      
         }
         meas = std::move(s->data);
         s->seq.store(p + total_capacity, std::memory_order_release);
+        count(POP_OK);
+        space.consumed([this] { return size(); });
         return queue_status::OK;
     }
 
+    // contention counters summed over all threads (see queue_stats), zeros without GLOBAL_QUEUE_STATS
+    queue_stats stats() {
+        queue_stats st;
+#ifdef GLOBAL_QUEUE_STATS
+        std::lock_guard<std::mutex> lock(stats_mtx);
+        for (const auto &b : stats_blocks) {
+            st.push_ok += b->counters[PUSH_OK].load(std::memory_order_relaxed);
+            st.push_full += b->counters[PUSH_FULL].load(std::memory_order_relaxed);
+            st.write_cas_failures += b->counters[WRITE_CAS_FAIL].load(std::memory_order_relaxed);
+            st.producer_slot_spins += b->counters[PRODUCER_SLOT_SPIN].load(std::memory_order_relaxed);
+            st.pop_ok += b->counters[POP_OK].load(std::memory_order_relaxed);
+            st.pop_empty += b->counters[POP_EMPTY].load(std::memory_order_relaxed);
+            st.read_cas_failures += b->counters[READ_CAS_FAIL].load(std::memory_order_relaxed);
+            st.consumer_slot_spins += b->counters[CONSUMER_SLOT_SPIN].load(std::memory_order_relaxed);
+            st.occupancy_high_water = std::max<uint64_t>(st.occupancy_high_water, b->counters[OCCUPANCY_HWM].load(std::memory_order_relaxed));
+        }
+#endif
+        return st;
+    }
+
+    static constexpr bool stats_enabled() {
+#ifdef GLOBAL_QUEUE_STATS
+        return true;
+#else
+        return false;
+#endif
+    }
+
 
     void shutdown() {
 
         if (shut_down.load(std::memory_order_acquire)) return;
         shut_down.store(true, std::memory_order_release);
+        space.notify_all();
     }
 };
 
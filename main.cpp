@@ -8,9 +8,18 @@
 #include <iostream>
 #include <chrono>
 
-void consumer(global_queue<measurement> &gq) {
+void consumer(lockless_global_queue<measurement> &gq) {
     measurement ms;
-    while (gq.pop(ms)) {
+    while (true) {
+        queue_status q_status = gq.pop(ms);
+        if (q_status == queue_status::SHUTDOWN) {
+            break;
+        }
+        if (q_status != queue_status::OK) {
+            //pop does not block
+            std::this_thread::yield();
+            continue;
+        }
         std::cout << " q.pop(ms), measurement:  ";
         for (const uint8_t &element : ms.payload) {
             std::cout << (int)element << " ";  
@@ -22,7 +31,7 @@ void consumer(global_queue<measurement> &gq) {
 int main(int argc, char const *argv[]) {
 
     fake_sensor_source f_sensor;
-    global_queue<measurement> q(64);
+    lockless_global_queue<measurement> q(64);
     fake_frame_parser parser;
     std::thread consumer_th(consumer, std::ref(q));
 
@@ -0,0 +1,153 @@
+#ifndef _MEASUREMENT_BATCH_H_
+#define _MEASUREMENT_BATCH_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <span>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+#include "measurement.h"
+#include "queue_concept.h"
+#include "memory_budget.h"
+#include "tracer.h"
+
+/*
+    Columnar (structure-of-arrays) view of many measurements.
+
+    measurement is array-of-structs with one heap payload per item, bad for bulk analytics.
+    Here every field is its own contiguous array, and all payloads are packed back to back
+    in one arena:
+
+        payload(i) = payload_arena[payload_offsets[i] .. payload_offsets[i + 1])
+
+    payload_offsets always holds size() + 1 entries (first is 0).
+    Timestamps are steady_clock nanoseconds (time_since_epoch), so loops over them are plain int64 math.
+*/
+
+struct measurement_batch {
+
+    std::vector<int64_t> timestamps_ns;
+    std::vector<size_t> sensor_ids;
+    std::vector<size_t> sequence_numbers;
+    std::vector<uint32_t> payload_offsets{0};
+    std::vector<uint8_t> payload_arena;
+
+    size_t size() const { return sensor_ids.size(); }
+    bool empty() const { return sensor_ids.empty(); }
+
+    // keeps allocated capacity, so a reused batch does not allocate in steady state
+    void clear() {
+        timestamps_ns.clear();
+        sensor_ids.clear();
+        sequence_numbers.clear();
+        payload_offsets.resize(1);
+        payload_arena.clear();
+    }
+
+    void reserve(size_t items, size_t payload_bytes) {
+        timestamps_ns.reserve(items);
+        sensor_ids.reserve(items);
+        sequence_numbers.reserve(items);
+        payload_offsets.reserve(items + 1);
+        payload_arena.reserve(payload_bytes);
+    }
+
+    void append(const measurement &m) {
+        timestamps_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(m.system_timestamp.time_since_epoch()).count());
+        sensor_ids.push_back(m.sensor_id);
+        sequence_numbers.push_back(m.sequence_number);
+        payload_arena.insert(payload_arena.end(), m.payload.begin(), m.payload.end());
+        payload_offsets.push_back(static_cast<uint32_t>(payload_arena.size()));
+    }
+
+    std::span<const uint8_t> payload(size_t i) const {
+        return std::span<const uint8_t>(payload_arena.data() + payload_offsets[i], payload_offsets[i + 1] - payload_offsets[i]);
+    }
+};
+
+/*
+    Drains the global queue (any global_queue_backend) into measurement_batch.
+
+    next_batch() returns when either:
+    - max_items measurements were collected
+    - max_latency passed since the first measurement of the batch was popped
+      (a slow trickle still reaches downstream within a bounded delay)
+    - the queue was shut down
+
+    The queue pop is non-blocking, while the batch is empty the consumer
+    backs off (yield, then short sleeps) instead of spinning a full core.
+    Single consumer only (same as the global queue).
+*/
+
+template <measurement_queue Queue>
+class batch_consumer
+{
+private:
+    static constexpr size_t spins_before_sleep = 64;
+    static constexpr std::chrono::microseconds idle_sleep{50};
+    Queue &global_q;
+    size_t max_items;
+    std::chrono::microseconds max_latency;
+    measurement scratch; //reused so the pop target keeps its payload capacity
+    memory_budget *budget; //optional, payload bytes are released after pop
+
+public:
+    // max_items must be larger then 0
+    batch_consumer(Queue &g_q, size_t max_batch_items, std::chrono::microseconds max_batch_latency, memory_budget *mem_budget = nullptr) : global_q(g_q), max_items(max_batch_items), max_latency(max_batch_latency), budget(mem_budget) {
+        if (max_batch_items == 0) {
+            throw std::invalid_argument("illegal batch size");
+        }
+    }
+
+    size_t max_batch_items() const { return max_items; }
+
+    /*
+        Clears batch and fills it.
+        Returns false only when the queue is shut down and nothing was collected.
+    */
+    bool next_batch(measurement_batch &batch) {
+        batch.clear();
+        std::chrono::steady_clock::time_point deadline{};
+        size_t idle_rounds = 0;
+
+        while (true) {
+            queue_status q_status = global_q.pop(scratch);
+
+            if (q_status == queue_status::OK) {
+                TRACE_INSTANT(POP, scratch.sensor_id, scratch.payload.size());
+                if (budget != nullptr) {
+                    budget->release(memory_category::IN_FLIGHT_PAYLOAD, scratch.payload.size());
+                }
+                if (batch.empty()) {
+                    deadline = std::chrono::steady_clock::now() + max_latency;
+                }
+                batch.append(scratch);
+                idle_rounds = 0;
+                if (batch.size() == max_items) {
+                    return true;
+                }
+                continue;
+            }
+
+            if (q_status == queue_status::SHUTDOWN) {
+                return !batch.empty();
+            }
+
+            //queue is empty
+            if (!batch.empty() && std::chrono::steady_clock::now() >= deadline) {
+                return true;
+            }
+
+            if (idle_rounds++ < spins_before_sleep) {
+                std::this_thread::yield();
+            }
+            else {
+                std::this_thread::sleep_for(idle_sleep);
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef _MEMORY_BUDGET_H_
+#define _MEMORY_BUDGET_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <array>
+#include <algorithm>
+
+/*
+    Pipeline wide memory budget (bytes), shared by sensor_manager, the workers and the consumer helpers.
+
+    Static memory (queue slots, stream buffers, read buffers, parser scratch) is reserved when a
+    component is created, sensor_manager rejects a sensor that does not fit.
+    Dynamic memory (payload bytes between push and pop) is reserved by the worker before push and
+    released by the consumer after pop, a frame that does not fit is dropped and counted
+    (budget_drops in sensor_worker) instead of growing RSS.
+
+    limit 0 => unlimited and untracked: try_reserve() / release() return at once, so the default
+    budget puts no shared counter on the push / pop path (used_bytes() and category_bytes() stay 0).
+    try_reserve() / release() are lock free and may be called from any thread. The total and every
+    category counter sit on their own cache line.
+*/
+
+enum class memory_category {
+    QUEUE_SLOTS,
+    STREAM_BUFFERS,
+    PARSER_SCRATCH,
+    IN_FLIGHT_PAYLOAD,
+    SNAPSHOT_TABLES, //latest_value_table
+    COUNT
+};
+
+class memory_budget
+{
+private:
+    static constexpr size_t category_count = static_cast<size_t>(memory_category::COUNT);
+    struct alignas(64) padded_counter {
+        std::atomic<size_t> value{0};
+    };
+
+    size_t limit;
+    padded_counter used;
+    std::array<padded_counter, category_count> per_category;
+    padded_counter rejected;
+
+public:
+    memory_budget(size_t limit_bytes = 0) : limit(limit_bytes) {}
+
+    memory_budget(const memory_budget&) = delete;
+    memory_budget& operator=(const memory_budget&) = delete;
+
+    bool try_reserve(memory_category category, size_t bytes) {
+        if (limit == 0) {
+            return true;
+        }
+        size_t current = used.value.load(std::memory_order_relaxed);
+        do {
+            if (bytes > limit - std::min(current, limit)) {
+                rejected.value.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        } while (!used.value.compare_exchange_weak(current, current + bytes, std::memory_order_relaxed, std::memory_order_relaxed));
+
+        per_category[static_cast<size_t>(category)].value.fetch_add(bytes, std::memory_order_relaxed);
+        return true;
+    }
+
+    void release(memory_category category, size_t bytes) {
+        if (limit == 0) {
+            return;
+        }
+        per_category[static_cast<size_t>(category)].value.fetch_sub(bytes, std::memory_order_relaxed);
+        used.value.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    size_t limit_bytes() const { return limit; }
+    size_t used_bytes() const { return used.value.load(std::memory_order_relaxed); }
+
+    size_t category_bytes(memory_category category) const {
+        return per_category[static_cast<size_t>(category)].value.load(std::memory_order_relaxed);
+    }
+
+    size_t rejected_count() const { return rejected.value.load(std::memory_order_relaxed); }
+};
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef _MEMORY_POLICY_H_
+#define _MEMORY_POLICY_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <limits>
+#include <utility>
+#include <system_error>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+/*
+    Placement policy for the big long lived buffers (global queue slots, stream buffers).
+
+    numa_node:
+        -1 : no binding, pages are placed by first touch.
+             policy_allocator never zero fills (default-init), so a stream buffer is first touched
+             by the thread that first writes it (the worker thread), not by the control thread.
+             policy_array constructs every element in its constructor: the queue slot arrays hold
+             atomics and measurement objects (std::vector members) whose constructors write every
+             slot, so their pages land on the node of the thread that constructs the queue.
+             Construct the queue on the consumer's node, or bind it with numa_node.
+        >=0: mbind(MPOL_BIND) the mapping to that node before it is touched.
+
+    huge_pages:
+        NONE    : regular 4 KB pages
+        THP     : madvise(MADV_HUGEPAGE), kernel may back the mapping with 2 MB pages
+        HUGETLB : MAP_HUGETLB from the reserved pool, falls back to THP when the pool is empty
+
+    The default policy allocates with aligned operator new (no syscalls, small buffers stay on the heap),
+    any other policy maps whole pages with mmap.
+
+    std::system_error for mmap / mbind failures (same as the rest of the syscall wrappers).
+*/
+
+enum class huge_page_mode { NONE, THP, HUGETLB };
+
+struct memory_policy {
+    int numa_node = -1;
+    huge_page_mode huge_pages = huge_page_mode::NONE;
+
+    bool is_default() const {
+        return numa_node < 0 && huge_pages == huge_page_mode::NONE;
+    }
+};
+
+namespace memory_policy_detail {
+
+    static constexpr size_t cache_line = 64;
+    static constexpr size_t huge_page_size = 2 * 1024 * 1024;
+
+    inline size_t mapping_size(size_t bytes, const memory_policy &policy) {
+        size_t page = (policy.huge_pages == huge_page_mode::NONE) ? static_cast<size_t>(sysconf(_SC_PAGESIZE)) : huge_page_size;
+        return (bytes + page - 1) / page * page;
+    }
+
+    inline void* allocate(size_t bytes, const memory_policy &policy) {
+        if (policy.is_default()) {
+            return ::operator new(bytes, std::align_val_t(cache_line));
+        }
+
+        size_t len = mapping_size(bytes, policy);
+        void *p = MAP_FAILED;
+
+        if (policy.huge_pages == huge_page_mode::HUGETLB) {
+            p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+        if (p == MAP_FAILED) {
+            p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) {
+                throw std::system_error(errno, std::generic_category(), "mmap failed ");
+            }
+            if (policy.huge_pages != huge_page_mode::NONE) {
+                //best effort, THP may be disabled system wide
+                madvise(p, len, MADV_HUGEPAGE);
+            }
+        }
+
+        if (policy.numa_node >= 0) {
+            unsigned long node_mask[4]{};
+            size_t bits = sizeof(node_mask) * 8;
+            if (static_cast<size_t>(policy.numa_node) >= bits) {
+                munmap(p, len);
+                throw std::system_error(EINVAL, std::generic_category(), "numa node out of range ");
+            }
+            node_mask[policy.numa_node / (sizeof(unsigned long) * 8)] |= 1UL << (policy.numa_node % (sizeof(unsigned long) * 8));
+            if (syscall(SYS_mbind, p, len, MPOL_BIND, node_mask, bits + 1, MPOL_MF_MOVE) != 0) {
+                int err = errno;
+                munmap(p, len);
+                throw std::system_error(err, std::generic_category(), "mbind failed ");
+            }
+        }
+        return p;
+    }
+
+    inline void deallocate(void *p, size_t bytes, const memory_policy &policy) noexcept {
+        if (p == nullptr) {
+            return;
+        }
+        if (policy.is_default()) {
+            ::operator delete(p, std::align_val_t(cache_line));
+            return;
+        }
+        munmap(p, mapping_size(bytes, policy));
+    }
+}
+
+/*
+    Stateful std allocator that applies a memory_policy.
+    construct() without arguments default-initializes (no zero fill), so vector::resize()
+    does not touch the pages of trivial element types.
+*/
+template <typename T>
+class policy_allocator
+{
+public:
+    using value_type = T;
+
+    memory_policy policy;
+
+    policy_allocator() = default;
+    policy_allocator(const memory_policy &p) : policy(p) {}
+
+    template <typename U>
+    policy_allocator(const policy_allocator<U> &rhs) : policy(rhs.policy) {}
+
+    T* allocate(size_t n) {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(memory_policy_detail::allocate(n * sizeof(T), policy));
+    }
+
+    void deallocate(T *p, size_t n) noexcept {
+        memory_policy_detail::deallocate(p, n * sizeof(T), policy);
+    }
+
+    template <typename U>
+    void construct(U *p) {
+        ::new (static_cast<void*>(p)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U *p, Args&&... args) {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    bool operator==(const policy_allocator<U> &rhs) const {
+        return policy.numa_node == rhs.policy.numa_node && policy.huge_pages == rhs.policy.huge_pages;
+    }
+};
+
+/*
+    Fixed size array placed by a memory_policy, for element types that are not movable
+    (the queue slots hold atomics, so std::vector cannot be used).
+    All elements are constructed here, by the calling thread (which first touches the pages).
+*/
+template <typename T>
+class policy_array
+{
+private:
+    T *data_ptr;
+    size_t count;
+    memory_policy policy;
+
+public:
+    policy_array() : data_ptr(nullptr), count(0) {}
+
+    policy_array(size_t n, const memory_policy &p) : data_ptr(nullptr), count(0), policy(p) {
+        data_ptr = static_cast<T*>(memory_policy_detail::allocate(n * sizeof(T), policy));
+        for (; count < n; count++) {
+            ::new (static_cast<void*>(data_ptr + count)) T();
+        }
+    }
+
+    ~policy_array() {
+        for (size_t i = 0; i < count; i++) {
+            data_ptr[i].~T();
+        }
+        memory_policy_detail::deallocate(data_ptr, count * sizeof(T), policy);
+    }
+
+    policy_array(const policy_array&) = delete;
+    policy_array& operator=(const policy_array&) = delete;
+
+    T& operator[](size_t i) { return data_ptr[i]; }
+    const T& operator[](size_t i) const { return data_ptr[i]; }
+    size_t size() const { return count; }
+};
+
+#endif
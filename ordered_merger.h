@@ -0,0 +1,286 @@
+#ifndef _ORDERED_MERGER_H_
+#define _ORDERED_MERGER_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <queue>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+#include "measurement.h"
+#include "queue_concept.h"
+#include "memory_budget.h"
+#include "tracer.h"
+
+/*
+    Time ordered delivery at the consumer (optional stage after global_queue).
+
+    global_queue delivers in push order, this stage re-orders by system_timestamp with a
+    k-way merge: one bounded ring per sensor (each sensor is already in timestamp order)
+    and a min-heap holding the head of every non-empty ring.
+
+    Low watermark: the newest timestamp received from a sensor, nothing older can arrive from it.
+    The heap head is released once every active sensor's watermark has passed it.
+
+    Active sensor: seen at least once, and (SKIP_IDLE policy) received something within idle_timeout.
+    With WAIT_IDLE a silent sensor holds everything back until max_lateness forces release.
+
+    max_lateness: a measurement older than (now - max_lateness) is released even if some
+    watermark did not pass it, this bounds the added delay.
+    A measurement that arrives older than the last released one is dropped and counted (late_drops).
+
+    Memory is bounded by max_sensors * per_sensor_capacity measurements, a full ring forces the
+    oldest buffered measurement out (forced_releases).
+
+    Sensor ids must be smaller than max_sensors (sensor_manager assigns them from 0).
+    Single consumer thread only.
+*/
+
+enum class idle_sensor_policy { WAIT_IDLE, SKIP_IDLE };
+
+struct ordered_merge_config {
+    size_t max_sensors;
+    size_t per_sensor_capacity;
+    std::chrono::milliseconds max_lateness;
+    idle_sensor_policy idle_policy = idle_sensor_policy::SKIP_IDLE;
+    std::chrono::milliseconds idle_timeout{100};
+};
+
+class ordered_merger
+{
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct sensor_ring {
+        std::vector<measurement> vec;
+        size_t read = 0;
+        size_t count = 0;
+        bool seen = false;
+        clock::time_point watermark{};
+        clock::time_point last_arrival{};
+    };
+
+    struct heap_entry {
+        clock::time_point ts;
+        size_t sensor_id;
+        bool operator>(const heap_entry &rhs) const { return ts > rhs.ts; }
+    };
+
+    ordered_merge_config conf;
+    std::vector<sensor_ring> rings;
+    std::priority_queue<heap_entry, std::vector<heap_entry>, std::greater<heap_entry>> heads;
+    //lower bound of the active watermarks, watermarks only move forward so it is recomputed only when too low,
+    //push() lowers it when a sensor becomes active
+    clock::time_point min_watermark{};
+    clock::time_point last_released{};
+    bool released_any;
+    size_t late_drops;
+    size_t forced_releases;
+    size_t lateness_releases;
+
+    bool is_active(const sensor_ring &r, clock::time_point now) const {
+        if (!r.seen) {
+            return false;
+        }
+        if (conf.idle_policy == idle_sensor_policy::SKIP_IDLE && r.count == 0 && now - r.last_arrival > conf.idle_timeout) {
+            return false;
+        }
+        return true;
+    }
+
+    clock::time_point compute_min_watermark(clock::time_point now) const {
+        clock::time_point min_wm = clock::time_point::max();
+        for (const sensor_ring &r : rings) {
+            if (is_active(r, now) && r.watermark < min_wm) {
+                min_wm = r.watermark;
+            }
+        }
+        return min_wm;
+    }
+
+    void release_head(measurement &out) {
+        heap_entry e = heads.top();
+        heads.pop();
+
+        sensor_ring &r = rings[e.sensor_id];
+        out = std::move(r.vec[r.read]);
+        r.read = (r.read + 1) == r.vec.size() ? 0 : r.read + 1;
+        r.count--;
+        if (r.count > 0) {
+            heads.push(heap_entry{r.vec[r.read].system_timestamp, e.sensor_id});
+        }
+
+        last_released = e.ts;
+        released_any = true;
+    }
+
+public:
+    ordered_merger(const ordered_merge_config &config) : conf(config), released_any(false), late_drops(0), forced_releases(0), lateness_releases(0) {
+        if (conf.max_sensors == 0 || conf.per_sensor_capacity == 0) {
+            throw std::invalid_argument("illegal ordered merge config");
+        }
+        rings.resize(conf.max_sensors);
+        for (sensor_ring &r : rings) {
+            r.vec.resize(conf.per_sensor_capacity);
+        }
+    }
+
+    /*
+        Buffers m. Returns false (m untouched) if the sensor ring is full,
+        the caller must pop() with force = true first.
+        Throws for sensor ids out of range.
+    */
+    bool push(measurement &m, clock::time_point now = clock::now()) {
+        if (m.sensor_id >= rings.size()) {
+            throw std::out_of_range("sensor id out of ordered merge range");
+        }
+
+        if (released_any && m.system_timestamp < last_released) {
+            late_drops++;
+            return true;
+        }
+
+        sensor_ring &r = rings[m.sensor_id];
+        if (r.count == r.vec.size()) {
+            return false;
+        }
+
+        bool was_active = is_active(r, now);
+        if (!r.seen || m.system_timestamp > r.watermark) {
+            r.watermark = m.system_timestamp;
+        }
+        r.seen = true;
+        r.last_arrival = now;
+
+        //a sensor joining the active set (first frame, or back from SKIP_IDLE) can be behind the cached bound
+        if (!was_active && r.watermark < min_watermark) {
+            min_watermark = r.watermark;
+        }
+
+        size_t w = r.read + r.count;
+        w = (w >= r.vec.size()) ? w - r.vec.size() : w;
+        if (r.count == 0) {
+            heads.push(heap_entry{m.system_timestamp, m.sensor_id});
+        }
+        r.vec[w] = std::move(m);
+        r.count++;
+        return true;
+    }
+
+    /*
+        Releases the oldest buffered measurement if ordering allows it.
+        force = true releases it regardless of watermarks (used when a ring is full).
+    */
+    bool pop(measurement &out, clock::time_point now = clock::now(), bool force = false) {
+        if (heads.empty()) {
+            return false;
+        }
+
+        clock::time_point head_ts = heads.top().ts;
+
+        if (force) {
+            forced_releases++;
+            release_head(out);
+            return true;
+        }
+
+        if (head_ts <= min_watermark) {
+            release_head(out);
+            return true;
+        }
+
+        min_watermark = compute_min_watermark(now);
+        if (head_ts <= min_watermark) {
+            release_head(out);
+            return true;
+        }
+
+        if (head_ts <= now - conf.max_lateness) {
+            lateness_releases++;
+            release_head(out);
+            return true;
+        }
+
+        return false;
+    }
+
+    //unconditional release in timestamp order, for draining after the input ended
+    bool drain(measurement &out) {
+        if (heads.empty()) {
+            return false;
+        }
+        release_head(out);
+        return true;
+    }
+
+    bool empty() const { return heads.empty(); }
+
+    size_t get_late_drops() const { return late_drops; }
+    size_t get_forced_releases() const { return forced_releases; }
+    size_t get_lateness_releases() const { return lateness_releases; }
+};
+
+/*
+    Consumer helper: global_queue -> ordered_merger -> caller.
+    next() blocks (backing off like batch_consumer) until a measurement can be released
+    in order, or returns false once the queue is shut down and the merger is drained.
+*/
+
+template <measurement_queue Queue>
+class ordered_consumer
+{
+private:
+    static constexpr std::chrono::microseconds idle_sleep{50};
+    Queue &global_q;
+    ordered_merger merger;
+    measurement scratch;
+    bool pending; //scratch holds a popped measurement that did not fit in its ring
+    bool shut_down;
+    memory_budget *budget; //optional, payload bytes are released after pop
+
+public:
+    ordered_consumer(Queue &g_q, const ordered_merge_config &config, memory_budget *mem_budget = nullptr) : global_q(g_q), merger(config), pending(false), shut_down(false), budget(mem_budget) {
+    }
+
+    bool next(measurement &out) {
+        while (true) {
+            //move everything available into the merger first, so watermarks are up to date
+            while (!shut_down) {
+                if (!pending) {
+                    queue_status q_status = global_q.pop(scratch);
+                    if (q_status == queue_status::SHUTDOWN) {
+                        shut_down = true;
+                        break;
+                    }
+                    if (q_status != queue_status::OK) {
+                        break;
+                    }
+                    TRACE_INSTANT(POP, scratch.sensor_id, scratch.payload.size());
+                    if (budget != nullptr) {
+                        budget->release(memory_category::IN_FLIGHT_PAYLOAD, scratch.payload.size());
+                    }
+                }
+                pending = !merger.push(scratch);
+                if (pending) {
+                    return merger.pop(out, std::chrono::steady_clock::now(), true);
+                }
+            }
+
+            if (shut_down) {
+                //no more input: drain in timestamp order
+                return merger.drain(out);
+            }
+
+            if (merger.pop(out)) {
+                return true;
+            }
+
+            std::this_thread::sleep_for(idle_sleep);
+        }
+    }
+
+    const ordered_merger& get_merger() const { return merger; }
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef _PACKET_SOURCE_H_
+#define _PACKET_SOURCE_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <chrono>
+#include <sys/types.h>
+
+/*
+    Source of already packetized data (SPI style sensors, local device daemons).
+
+    sensor_source delivers a byte stream that has to be reassembled (stream_buffer) and framed
+    (frame_parser). A packet_source delivers whole datagrams, one datagram is one measurement
+    payload, see packet_worker.h.
+
+    read_packets():
+    - blocks until at least one packet is available or stop_request() was called
+    - fills packets[0..n) with a copy of each datagram (the vector is resized to the datagram length,
+      its capacity is reused unless the worker moved the payload out)
+      and timestamps[0..n) with the receive time of each packet (kernel timestamp when the source has one)
+    - returns n > 0, 0 on stop / end of stream, -1 on error
+*/
+
+class packet_source
+{
+public:
+    virtual ~packet_source() = default;
+
+    virtual ssize_t read_packets(std::vector<uint8_t> *packets, std::chrono::steady_clock::time_point *timestamps, size_t max_packets) = 0;
+
+    // unblocks a pending read_packets(), which then returns 0
+    virtual int stop_request() = 0;
+
+    // largest datagram accepted, longer ones are dropped (and counted by the source)
+    virtual size_t max_packet_size() const = 0;
+
+    // packets per read_packets() call the source can deliver at most
+    virtual size_t max_batch() const = 0;
+};
+
+#endif
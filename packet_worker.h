@@ -0,0 +1,188 @@
+#ifndef _PACKET_WORKER_H_
+#define _PACKET_WORKER_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <span>
+#include <functional>
+#include "packet_source.h"
+#include "queue_concept.h"
+#include "measurement.h"
+#include "memory_budget.h"
+#include "latest_value_table.h"
+#include "tracer.h"
+#include "perf_counters.h"
+
+/*
+    Worker for packetized sources (packet_source.h): one datagram is one measurement.
+
+    sensor_worker: read bytes -> stream_buffer -> parser chunks -> frame -> measurement.
+    Here: read_packets() -> (optional validator) -> payload moved into the measurement -> push.
+    system_timestamp is the receive time reported by the source (kernel timestamp for UDP).
+    No stream buffer and no byte parser. There is one copy per packet: the source copies each datagram
+    out of its recvmmsg() arena into packets[i] (sized to the datagram, so one allocation per pushed packet,
+    a rejected or dropped packet keeps its vector for the next read). Receiving straight into the payload
+    vectors would save the copy but leave max_packet_size of capacity in every queued measurement.
+
+    The validator gets the whole datagram and returns false to reject it (bad CRC, wrong version ...),
+    rejected packets are dropped and counted (get_validation_failures()).
+
+    Backpressure: FULL drops the packet (counted in get_queue_full_failures()), the socket
+    buffers in the kernel meanwhile, there is no stream buffer to hold bytes.
+
+    Same start() / stop() rules as sensor_worker (thread per worker).
+*/
+
+using packet_validator = std::function<bool(std::span<const uint8_t>)>;
+
+template <measurement_queue Queue>
+class packet_worker
+{
+private:
+    size_t sensor_id;
+    packet_source &p_source;
+    Queue &global_q;
+    packet_validator validator; //empty => every packet is accepted
+    memory_budget *budget; //optional, nullptr => in-flight payload bytes are not accounted
+    latest_value_table *latest_values; //optional, nullptr => no latest value per sensor
+    std::atomic<bool> stop_req;
+    bool started;
+    size_t read_errors;
+    size_t eos_count;
+    size_t validation_failures;
+    size_t queue_full_failures;
+    size_t budget_drops;
+    std::vector<std::vector<uint8_t>> packets; //reused between reads, a pushed payload is replaced by an empty vector
+    std::vector<std::chrono::steady_clock::time_point> timestamps;
+    std::thread worker_thread;
+
+    void publish(std::vector<uint8_t> &packet, std::chrono::steady_clock::time_point received) {
+        if (validator && !validator(std::span<const uint8_t>(packet))) {
+            validation_failures++;
+            return;
+        }
+
+        if (latest_values != nullptr) {
+            latest_values->update(sensor_id, packet.data(), packet.size(), received, 0);
+        }
+
+        size_t payload_bytes = packet.size();
+        if (budget != nullptr && !budget->try_reserve(memory_category::IN_FLIGHT_PAYLOAD, payload_bytes)) {
+            budget_drops++;
+            return;
+        }
+
+        measurement meas;
+        meas.payload = std::move(packet);
+        meas.system_timestamp = received;
+        meas.sensor_id = sensor_id;
+
+        queue_status q_status;
+        {
+            PERF_SCOPE(push_perf, PUSH, sensor_id);
+            TRACE_BEGIN(push_span);
+            q_status = global_q.push(std::move(meas));
+            TRACE_END(push_span, PUSH, sensor_id, payload_bytes, q_status);
+        }
+        if (q_status == queue_status::OK) {
+            PERF_FRAMES(sensor_id, 1);
+            return;
+        }
+
+        if (budget != nullptr) {
+            budget->release(memory_category::IN_FLIGHT_PAYLOAD, payload_bytes);
+        }
+        if (q_status == queue_status::FULL) {
+            queue_full_failures++;
+        }
+        else if (q_status == queue_status::SHUTDOWN) {
+            eos_count++;
+        }
+    }
+
+    void run() {
+        while (!stop_req.load()) {
+
+            ssize_t n;
+            {
+                PERF_SCOPE(read_perf, READ, sensor_id);
+                TRACE_BEGIN(read_span);
+                n = p_source.read_packets(packets.data(), timestamps.data(), packets.size());
+                TRACE_END(read_span, READ, sensor_id, n, 0);
+            }
+
+            if (n == 0) {
+                eos_count++;
+                break;
+            }
+
+            if (n < 0) {
+                read_errors++;
+                continue;
+            }
+
+            PERF_SCOPE(parse_perf, PARSE, sensor_id);
+            for (ssize_t i = 0; i < n; i++) {
+                PERF_BYTES(sensor_id, packets[static_cast<size_t>(i)].size());
+                publish(packets[static_cast<size_t>(i)], timestamps[static_cast<size_t>(i)]);
+            }
+        }
+    }
+
+public:
+    packet_worker(size_t sensorid, packet_source &p_s, Queue &g_q, packet_validator packet_check = {}, memory_budget *mem_budget = nullptr, latest_value_table *latest = nullptr) : sensor_id(sensorid), p_source(p_s), global_q(g_q), validator(std::move(packet_check)), budget(mem_budget), latest_values(latest), stop_req(false), started(false), read_errors(0), eos_count(0), validation_failures(0), queue_full_failures(0), budget_drops(0), packets(p_s.max_batch()), timestamps(p_s.max_batch()) {
+    }
+
+    ~packet_worker() {
+        stop();
+    }
+
+    packet_worker(const packet_worker&) = delete;
+    packet_worker& operator=(const packet_worker&) = delete;
+
+    // start() may be called only once per object lifetime, from a single control thread
+    bool start() {
+        if (started) {
+            return false;
+        }
+        started = true;
+        stop_req = false;
+        worker_thread = std::thread(&packet_worker::run, this);
+        return true;
+    }
+
+    void stop() {
+        if (stop_req.exchange(true) || !started) {
+            return;
+        }
+        p_source.stop_request();
+        if (worker_thread.joinable()) {
+            worker_thread.join();
+        }
+        started = false;
+    }
+
+    size_t get_sensor_id() const { return sensor_id; }
+    size_t get_read_errors_count() const { return read_errors; }
+    size_t get_eos_count() const { return eos_count; }
+
+    // packets rejected by the validator
+    size_t get_validation_failures() const { return validation_failures; }
+
+    // packets dropped because the queue was full
+    size_t get_queue_full_failures() const { return queue_full_failures; }
+
+    // packets dropped because the pipeline memory budget was exhausted
+    size_t get_budget_drops() const { return budget_drops; }
+
+    // source receive arena (worst case: a full batch of max size packets)
+    size_t static_memory_bytes() const {
+        return p_source.max_batch() * p_source.max_packet_size();
+    }
+};
+
+#endif
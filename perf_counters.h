@@ -0,0 +1,549 @@
+#ifndef _PERF_COUNTERS_H_
+#define _PERF_COUNTERS_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+/*
+    Hardware performance counters per pipeline stage, compiled in only with -DSENSOR_PIPELINE_PERF.
+
+    Without the define the PERF_* macros expand to nothing (same rule as tracer.h).
+
+    With the define every thread that enters a stage opens one perf_event_open group for itself
+    (pid 0, any cpu): cycles, instructions, branch misses, L1D read misses, LLC read misses and
+    context switches. Stage scopes read the whole group (one read() of PERF_FORMAT_GROUP) on entry and
+    on exit, and the difference is attributed to (sensor, stage). Scopes nest exclusively: entering PUSH
+    inside PARSE stops charging PARSE until PUSH ends, so
+
+        READ     source read (the syscall, when the kernel is counted)
+        PARSE    stream buffer + feed_bytes() + frame assembly (+ payload decode)
+        PUSH     global queue push
+        POP      consumer pop (sensor_manager::pop, stage_graph input)
+        CONSUME  stage_graph stages
+
+    do not overlap. Worker stages are charged to their sensor_id, consumer stages to perf_profiler::consumer.
+    The workers also count frames pushed and bytes read, so the report is per frame and per byte.
+
+    Overhead: one read() syscall per stage transition. It is measured once per thread (minimum cost of
+    an empty region) and subtracted in the report, the remaining numbers are still biased on regions of
+    a few hundred cycles, compare stages and builds, not absolute values.
+
+    Degradation (containers, VMs, perf_event_paranoid):
+    - kernel counting is tried first, EACCES / EPERM => user space only (kernel_counted() == false)
+    - an event the PMU does not have (ENOENT, EOPNOTSUPP ...) is left out, its columns are null
+    - no event at all => scopes do nothing, the report still has frames / bytes, available() == false
+    Multiplexed groups (time_running < time_enabled) are scaled and flagged in the report.
+*/
+
+enum class perf_stage : uint8_t {
+    READ,
+    PARSE,
+    PUSH,
+    POP,
+    CONSUME,
+    COUNT
+};
+
+enum class perf_event_id : uint8_t {
+    CYCLES,
+    INSTRUCTIONS,
+    BRANCH_MISSES,
+    L1D_MISSES,
+    LLC_MISSES,
+    CONTEXT_SWITCHES,
+    COUNT
+};
+
+inline constexpr size_t perf_stage_count = static_cast<size_t>(perf_stage::COUNT);
+inline constexpr size_t perf_event_count = static_cast<size_t>(perf_event_id::COUNT);
+
+inline const char* perf_stage_name(perf_stage s) {
+    switch (s) {
+    case perf_stage::READ: return "read";
+    case perf_stage::PARSE: return "parse";
+    case perf_stage::PUSH: return "push";
+    case perf_stage::POP: return "pop";
+    default: return "consume";
+    }
+}
+
+inline const char* perf_event_name(perf_event_id e) {
+    switch (e) {
+    case perf_event_id::CYCLES: return "cycles";
+    case perf_event_id::INSTRUCTIONS: return "instructions";
+    case perf_event_id::BRANCH_MISSES: return "branch_misses";
+    case perf_event_id::L1D_MISSES: return "l1d_misses";
+    case perf_event_id::LLC_MISSES: return "llc_misses";
+    default: return "context_switches";
+    }
+}
+
+/*
+    One perf_event_open group for the calling thread.
+    Every failure is recorded (available(), open_errno()), nothing throws.
+*/
+class perf_counter_group
+{
+private:
+    int fds[perf_event_count];
+    size_t group_index[perf_event_count]; //position in the PERF_FORMAT_GROUP read
+    int leader;
+    size_t members;
+    bool kernel;
+    int first_errno;
+    bool multiplexed;
+
+    static void event_attr(perf_event_id e, perf_event_attr &attr) {
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        switch (e) {
+        case perf_event_id::CYCLES:
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case perf_event_id::INSTRUCTIONS:
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case perf_event_id::BRANCH_MISSES:
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case perf_event_id::L1D_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case perf_event_id::LLC_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        default:
+            attr.type = PERF_TYPE_SOFTWARE;
+            attr.config = PERF_COUNT_SW_CONTEXT_SWITCHES;
+            break;
+        }
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.exclude_hv = 1;
+    }
+
+    int open_event(perf_event_id e, bool with_kernel) {
+        perf_event_attr attr;
+        event_attr(e, attr);
+        attr.exclude_kernel = with_kernel ? 0 : 1;
+        attr.disabled = (leader < 0) ? 1 : 0; //the leader starts the whole group
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, PERF_FLAG_FD_CLOEXEC));
+    }
+
+public:
+    perf_counter_group() : leader(-1), members(0), kernel(true), first_errno(0), multiplexed(false) {
+        for (size_t i = 0; i < perf_event_count; i++) {
+            fds[i] = -1;
+            group_index[i] = 0;
+            perf_event_id e = static_cast<perf_event_id>(i);
+
+            int fd = open_event(e, kernel);
+            if (fd < 0 && kernel && (errno == EACCES || errno == EPERM)) {
+                //perf_event_paranoid >= 2: user space only, for every event of the group
+                kernel = false;
+                fd = open_event(e, kernel);
+            }
+            if (fd < 0) {
+                if (first_errno == 0) {
+                    first_errno = errno;
+                }
+                continue;
+            }
+            fds[i] = fd;
+            group_index[i] = members++;
+            if (leader < 0) {
+                leader = fd;
+            }
+        }
+
+        if (leader >= 0) {
+            ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    ~perf_counter_group() {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    perf_counter_group(const perf_counter_group&) = delete;
+    perf_counter_group& operator=(const perf_counter_group&) = delete;
+
+    // counts since the group was opened (scaled when multiplexed), 0 for missing events
+    bool read_counts(uint64_t (&out)[perf_event_count]) {
+        std::fill(std::begin(out), std::end(out), 0);
+        if (leader < 0) {
+            return false;
+        }
+        uint64_t buf[3 + perf_event_count]; //nr, time_enabled, time_running, values
+        ssize_t n = read(leader, buf, sizeof(buf));
+        if (n < static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+            return false;
+        }
+        uint64_t enabled = buf[1];
+        uint64_t running = buf[2];
+        bool scaled = running != 0 && running < enabled;
+        multiplexed = multiplexed || scaled;
+        for (size_t i = 0; i < perf_event_count; i++) {
+            if (fds[i] < 0 || group_index[i] >= buf[0]) {
+                continue;
+            }
+            uint64_t v = buf[3 + group_index[i]];
+            out[i] = scaled ? static_cast<uint64_t>(static_cast<double>(v) * static_cast<double>(enabled) / static_cast<double>(running)) : v;
+        }
+        return true;
+    }
+
+    bool available() const { return leader >= 0; }
+    bool has_event(perf_event_id e) const { return fds[static_cast<size_t>(e)] >= 0; }
+    bool kernel_counted() const { return available() && kernel; }
+    bool was_multiplexed() const { return multiplexed; }
+    // errno of the first event that could not be opened, 0 when all opened
+    int open_errno() const { return first_errno; }
+};
+
+// per (sensor, stage) totals, written by the owner thread only, read by report()
+struct perf_stage_totals {
+    std::atomic<uint64_t> regions{0};
+    std::atomic<uint64_t> counts[perf_event_count]{};
+};
+
+struct perf_sensor_totals {
+    perf_stage_totals stages[perf_stage_count];
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> bytes{0};
+};
+
+struct perf_stage_report {
+    perf_stage stage;
+    uint64_t regions;
+    uint64_t counts[perf_event_count]; //overhead subtracted
+};
+
+struct perf_sensor_report {
+    size_t sensor_id; //perf_profiler::consumer for the consumer stages
+    uint64_t frames;
+    uint64_t bytes;
+    perf_stage_report stages[perf_stage_count];
+};
+
+class perf_profiler
+{
+public:
+    static constexpr size_t max_sensors = 256; //larger sensor ids are not profiled
+    static constexpr size_t consumer = static_cast<size_t>(-1);
+
+private:
+    static constexpr size_t slots = max_sensors + 1; //last slot: consumer
+
+    struct thread_state {
+        perf_counter_group group;
+        uint64_t overhead[perf_event_count]; //minimum cost of one empty region
+        std::unique_ptr<std::atomic<perf_sensor_totals*>[]> sensors;
+        std::vector<std::unique_ptr<perf_sensor_totals>> owned;
+        //active scope, owner thread only
+        size_t cur_slot = slots;
+        perf_stage cur_stage = perf_stage::COUNT;
+        uint64_t last[perf_event_count];
+
+        thread_state() : sensors(new std::atomic<perf_sensor_totals*>[slots]) {
+            for (size_t i = 0; i < slots; i++) {
+                sensors[i].store(nullptr, std::memory_order_relaxed);
+            }
+            calibrate();
+        }
+
+        void calibrate() {
+            std::fill(std::begin(overhead), std::end(overhead), 0);
+            if (!group.available()) {
+                return;
+            }
+            uint64_t prev[perf_event_count], now[perf_event_count];
+            group.read_counts(prev);
+            bool first = true;
+            for (int i = 0; i < 32; i++) {
+                group.read_counts(now);
+                for (size_t e = 0; e < perf_event_count; e++) {
+                    uint64_t d = now[e] - prev[e];
+                    overhead[e] = first ? d : std::min(overhead[e], d);
+                    prev[e] = now[e];
+                }
+                first = false;
+            }
+        }
+
+        perf_sensor_totals& totals(size_t slot) {
+            perf_sensor_totals *t = sensors[slot].load(std::memory_order_relaxed);
+            if (t == nullptr) {
+                owned.push_back(std::make_unique<perf_sensor_totals>());
+                t = owned.back().get();
+                sensors[slot].store(t, std::memory_order_release);
+            }
+            return *t;
+        }
+
+        // charges the counts since the last transition to the active scope
+        void charge(const uint64_t (&now)[perf_event_count]) {
+            if (cur_stage == perf_stage::COUNT) {
+                return;
+            }
+            perf_stage_totals &st = totals(cur_slot).stages[static_cast<size_t>(cur_stage)];
+            st.regions.store(st.regions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            for (size_t e = 0; e < perf_event_count; e++) {
+                st.counts[e].store(st.counts[e].load(std::memory_order_relaxed) + (now[e] - last[e]), std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::mutex threads_mtx;
+    std::vector<std::unique_ptr<thread_state>> threads;
+
+    perf_profiler() = default;
+
+    thread_state* register_thread() {
+        auto st = std::make_unique<thread_state>();
+        std::lock_guard<std::mutex> lock(threads_mtx);
+        threads.push_back(std::move(st));
+        return threads.back().get();
+    }
+
+    static thread_state& local() {
+        thread_local thread_state *st = instance().register_thread();
+        return *st;
+    }
+
+    // slots (out of range) for sensor ids that are not profiled
+    static size_t slot_of(size_t sensor_id) {
+        if (sensor_id == consumer) {
+            return max_sensors;
+        }
+        return (sensor_id < max_sensors) ? sensor_id : slots;
+    }
+
+    template <typename F>
+    static void add_to(size_t sensor_id, F &&f) {
+        size_t slot = slot_of(sensor_id);
+        if (slot < slots) {
+            f(local().totals(slot));
+        }
+    }
+
+public:
+    perf_profiler(const perf_profiler&) = delete;
+    perf_profiler& operator=(const perf_profiler&) = delete;
+
+    static perf_profiler& instance() {
+        static perf_profiler p;
+        return p;
+    }
+
+    /*
+        Stage transitions of the calling thread, used by perf_scope.
+        enter() returns the previous scope (restored by leave()).
+    */
+    struct saved_scope {
+        size_t slot;
+        perf_stage stage;
+    };
+
+    static saved_scope enter(perf_stage stage, size_t sensor_id) {
+        thread_state &st = local();
+        saved_scope prev{st.cur_slot, st.cur_stage};
+        size_t slot = slot_of(sensor_id);
+        if (!st.group.available() || slot >= slots) {
+            return prev;
+        }
+        uint64_t now[perf_event_count];
+        st.group.read_counts(now);
+        st.charge(now);
+        std::copy(std::begin(now), std::end(now), std::begin(st.last));
+        st.cur_slot = slot;
+        st.cur_stage = stage;
+        return prev;
+    }
+
+    static void leave(const saved_scope &prev) {
+        thread_state &st = local();
+        if (!st.group.available() || st.cur_stage == perf_stage::COUNT) {
+            return;
+        }
+        uint64_t now[perf_event_count];
+        st.group.read_counts(now);
+        st.charge(now);
+        std::copy(std::begin(now), std::end(now), std::begin(st.last));
+        st.cur_slot = prev.slot;
+        st.cur_stage = prev.stage;
+    }
+
+    static void add_frames(size_t sensor_id, uint64_t n) {
+        add_to(sensor_id, [n](perf_sensor_totals &t) { t.frames.store(t.frames.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); });
+    }
+
+    static void add_bytes(size_t sensor_id, uint64_t n) {
+        add_to(sensor_id, [n](perf_sensor_totals &t) { t.bytes.store(t.bytes.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); });
+    }
+
+    // sums over every thread, one entry per sensor seen (the consumer last)
+    std::vector<perf_sensor_report> report() {
+        std::vector<perf_sensor_report> out;
+        std::lock_guard<std::mutex> lock(threads_mtx);
+        for (size_t slot = 0; slot < slots; slot++) {
+            perf_sensor_report r{};
+            r.sensor_id = (slot == max_sensors) ? consumer : slot;
+            bool seen = false;
+            for (size_t s = 0; s < perf_stage_count; s++) {
+                r.stages[s].stage = static_cast<perf_stage>(s);
+            }
+            for (auto &th : threads) {
+                perf_sensor_totals *t = th->sensors[slot].load(std::memory_order_acquire);
+                if (t == nullptr) {
+                    continue;
+                }
+                seen = true;
+                r.frames += t->frames.load(std::memory_order_relaxed);
+                r.bytes += t->bytes.load(std::memory_order_relaxed);
+                for (size_t s = 0; s < perf_stage_count; s++) {
+                    uint64_t regions = t->stages[s].regions.load(std::memory_order_relaxed);
+                    r.stages[s].regions += regions;
+                    for (size_t e = 0; e < perf_event_count; e++) {
+                        uint64_t c = t->stages[s].counts[e].load(std::memory_order_relaxed);
+                        uint64_t cost = regions * th->overhead[e];
+                        r.stages[s].counts[e] += (c > cost) ? c - cost : 0;
+                    }
+                }
+            }
+            if (seen) {
+                out.push_back(r);
+            }
+        }
+        return out;
+    }
+
+    // events opened by at least one thread
+    bool has_event(perf_event_id e) {
+        std::lock_guard<std::mutex> lock(threads_mtx);
+        return std::any_of(threads.begin(), threads.end(), [e](const auto &th) { return th->group.has_event(e); });
+    }
+
+    bool available() {
+        std::lock_guard<std::mutex> lock(threads_mtx);
+        return std::any_of(threads.begin(), threads.end(), [](const auto &th) { return th->group.available(); });
+    }
+
+    bool kernel_counted() {
+        std::lock_guard<std::mutex> lock(threads_mtx);
+        return !threads.empty() && std::all_of(threads.begin(), threads.end(), [](const auto &th) { return th->group.kernel_counted(); });
+    }
+
+    bool multiplexed() {
+        std::lock_guard<std::mutex> lock(threads_mtx);
+        return std::any_of(threads.begin(), threads.end(), [](const auto &th) { return th->group.was_multiplexed(); });
+    }
+
+    int open_errno() {
+        std::lock_guard<std::mutex> lock(threads_mtx);
+        for (auto &th : threads) {
+            if (th->group.open_errno() != 0) {
+                return th->group.open_errno();
+            }
+        }
+        return 0;
+    }
+
+    /*
+        JSON lines, one per (sensor, stage) with regions, then one summary line:
+            {"sensor":0,"stage":"parse","regions":..,"frames":..,"bytes":..,"cycles":..,"cycles_per_frame":..,"cycles_per_byte":.., ...}
+        sensor is "consumer" for the consumer stages, missing events are null.
+    */
+    void print_json(std::FILE *out) {
+        bool have[perf_event_count];
+        for (size_t e = 0; e < perf_event_count; e++) {
+            have[e] = has_event(static_cast<perf_event_id>(e));
+        }
+
+        for (const perf_sensor_report &r : report()) {
+            for (const perf_stage_report &st : r.stages) {
+                if (st.regions == 0) {
+                    continue;
+                }
+                if (r.sensor_id == consumer) {
+                    std::fprintf(out, "{\"sensor\":\"consumer\"");
+                }
+                else {
+                    std::fprintf(out, "{\"sensor\":%zu", r.sensor_id);
+                }
+                std::fprintf(out, ",\"stage\":\"%s\",\"regions\":%llu,\"frames\":%llu,\"bytes\":%llu", perf_stage_name(st.stage),
+                    static_cast<unsigned long long>(st.regions), static_cast<unsigned long long>(r.frames), static_cast<unsigned long long>(r.bytes));
+                for (size_t e = 0; e < perf_event_count; e++) {
+                    const char *name = perf_event_name(static_cast<perf_event_id>(e));
+                    if (!have[e]) {
+                        std::fprintf(out, ",\"%s\":null,\"%s_per_frame\":null,\"%s_per_byte\":null", name, name, name);
+                        continue;
+                    }
+                    double c = static_cast<double>(st.counts[e]);
+                    std::fprintf(out, ",\"%s\":%llu", name, static_cast<unsigned long long>(st.counts[e]));
+                    std::fprintf(out, (r.frames != 0) ? ",\"%s_per_frame\":%.2f" : ",\"%s_per_frame\":null", name, (r.frames != 0) ? c / static_cast<double>(r.frames) : 0.0);
+                    std::fprintf(out, (r.bytes != 0) ? ",\"%s_per_byte\":%.3f" : ",\"%s_per_byte\":null", name, (r.bytes != 0) ? c / static_cast<double>(r.bytes) : 0.0);
+                }
+                size_t cyc = static_cast<size_t>(perf_event_id::CYCLES);
+                size_t ins = static_cast<size_t>(perf_event_id::INSTRUCTIONS);
+                if (have[cyc] && have[ins] && st.counts[cyc] != 0) {
+                    std::fprintf(out, ",\"ipc\":%.2f}\n", static_cast<double>(st.counts[ins]) / static_cast<double>(st.counts[cyc]));
+                }
+                else {
+                    std::fprintf(out, ",\"ipc\":null}\n");
+                }
+            }
+        }
+
+        int err = open_errno();
+        std::fprintf(out, "{\"perf_available\":%s,\"kernel_counted\":%s,\"multiplexed\":%s,\"open_error\":\"%s\"}\n",
+            available() ? "true" : "false", kernel_counted() ? "true" : "false", multiplexed() ? "true" : "false",
+            (err != 0) ? std::strerror(err) : "");
+        std::fflush(out);
+    }
+};
+
+// RAII stage region of the calling thread, see PERF_SCOPE
+class perf_scope
+{
+private:
+    perf_profiler::saved_scope prev;
+
+public:
+    perf_scope(perf_stage stage, size_t sensor_id) : prev(perf_profiler::enter(stage, sensor_id)) {}
+    ~perf_scope() { perf_profiler::leave(prev); }
+
+    perf_scope(const perf_scope&) = delete;
+    perf_scope& operator=(const perf_scope&) = delete;
+};
+
+#ifdef SENSOR_PIPELINE_PERF
+#define PERF_SCOPE(var, stage, sensor) perf_scope var(perf_stage::stage, (sensor))
+#define PERF_FRAMES(sensor, n) perf_profiler::add_frames((sensor), static_cast<uint64_t>(n))
+#define PERF_BYTES(sensor, n) perf_profiler::add_bytes((sensor), static_cast<uint64_t>(n))
+#else
+#define PERF_SCOPE(var, stage, sensor) do {} while (0)
+#define PERF_FRAMES(sensor, n) do {} while (0)
+#define PERF_BYTES(sensor, n) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef _QUEUE_CONCEPT_H_
+#define _QUEUE_CONCEPT_H_
+
+#include <cstddef>
+#include <concepts>
+#include <utility>
+#include "measurement.h"
+#include "memory_policy.h"
+#include "queue_space_notifier.h"
+
+enum class queue_status{ OK, FULL, EMPTY, SHUTDOWN };
+
+/*
+    Interface shared by the global queue backends (lockless_global_queue, locking_global_queue,
+    ticket_global_queue). sensor_worker, sensor_manager and the consumer helpers are templated on it,
+    so the backend is picked per sensor_manager instantiation:
+
+        sensor_manager<lockless_global_queue<measurement>> mgr(1024);
+        sensor_manager<locking_global_queue<measurement>> mgr(1024);
+        sensor_manager<ticket_global_queue<measurement>> mgr(1024);   //single consumer
+
+    push(item)   : OK, FULL (nothing was stored) or SHUTDOWN
+    pop(item&)   : non blocking, OK, EMPTY or SHUTDOWN
+    shutdown()   : wakes / fails every later push and pop
+    capacity()   : slots
+    size()       : items in the queue (may be approximate)
+    slot_bytes() : bytes per slot, for the memory budget
+    space_notifier() : wakeup for producers waiting after FULL, signalled by pop() (queue_space_notifier.h)
+    constructible from (capacity, memory_policy)
+*/
+template <typename Q>
+concept global_queue_backend = requires(Q &q, const Q &cq, typename Q::value_type &item) {
+    { q.push(std::move(item)) } -> std::same_as<queue_status>;
+    { q.pop(item) } -> std::same_as<queue_status>;
+    { q.shutdown() };
+    { cq.capacity() } -> std::convertible_to<size_t>;
+    { q.size() } -> std::convertible_to<size_t>;
+    { q.space_notifier() } -> std::same_as<queue_space_notifier&>;
+    { Q::slot_bytes() } -> std::convertible_to<size_t>;
+} && std::constructible_from<Q, size_t, const memory_policy&>;
+
+template <typename Q>
+concept measurement_queue = global_queue_backend<Q> && std::same_as<typename Q::value_type, measurement>;
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef _QUEUE_SPACE_NOTIFIER_H_
+#define _QUEUE_SPACE_NOTIFIER_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cerrno>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <stdexcept>
+#include <system_error>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "unique_fd.h"
+
+/*
+    "Queue has space again" wakeup for producers that got FULL.
+
+    Without it a sensor_worker that hit FULL only retries when the sensor sends more bytes,
+    for a slow sensor the frames already parsed wait seconds. With it the worker also polls its
+    waiter eventfd next to the source fd and resumes parsing once the consumer drained the queue.
+
+    Every waiting producer has its own eventfd (a shared one would need a drain by somebody,
+    and a producer that polls after the drain would miss the wakeup).
+
+    Producer (after FULL):
+        arm(slot)                 //announce the wait
+        occupancy <= low_water?   //re-check after arming, the consumer may have drained before it
+        poll(source fd, fd(slot))
+        disarm(slot)              //drains the eventfd, also after waking up for another reason
+    Consumer (every successful pop, any backend):
+        consumed(occupancy)       //relaxed loads only, except on the pop that crosses the low-water mark
+
+    arm() and the consumer check are ordered by seq_cst fences (Dekker style), either the consumer
+    sees the armed slot or the producer's re-check sees the freed space. The consumer only needs its
+    fence on the pop that takes the occupancy from above the mark to the mark (a producer waits only
+    after FULL, so the queue was above the mark since), or when it already sees an armed producer.
+    Pops below the mark and pops above it cost two relaxed loads, no barrier.
+    The mark must stay below capacity - 1 (the pop right after FULL has to see the queue above it),
+    so the notifier takes the queue capacity: capacity below 2 throws, the default mark is half the
+    capacity clamped to capacity - 2 and set_low_water() rejects a mark above capacity - 2.
+
+    The backends own one notifier each (space_notifier()).
+    Only producers that actually block take a slot (sensor_worker registers on its first FULL in
+    thread mode), release_waiter() puts the slot and its eventfd on a free list for the next one.
+    At most max_waiters slots are in use at the same time.
+*/
+
+class queue_space_notifier
+{
+public:
+    static constexpr size_t max_waiters = 256;
+
+private:
+    struct waiter {
+        unique_fd efd;
+        std::atomic<bool> armed{false};
+    };
+
+    std::unique_ptr<waiter[]> waiters;
+    std::vector<size_t> free_slots; //released slots, eventfd kept open
+    size_t max_low_water; //capacity - 2
+    std::atomic<size_t> registered;
+    std::atomic<size_t> armed_count;
+    std::atomic<size_t> low_water;
+    std::atomic<size_t> notifications;
+    std::atomic<bool> above_low_water; //consumer side, occupancy seen above the mark since the last crossing
+    std::mutex register_mtx;
+
+    static size_t validated_capacity(size_t capacity) {
+        if (capacity < 2) {
+            throw std::invalid_argument("illegal capacity value");
+        }
+        return capacity;
+    }
+
+public:
+    // capacity of the owning queue, throws std::invalid_argument below 2
+    queue_space_notifier(size_t capacity) : waiters(new waiter[max_waiters]), max_low_water(validated_capacity(capacity) - 2), registered(0), armed_count(0), low_water(std::min(capacity / 2, max_low_water)), notifications(0), above_low_water(false) {}
+
+    queue_space_notifier(const queue_space_notifier&) = delete;
+    queue_space_notifier& operator=(const queue_space_notifier&) = delete;
+
+    // one slot per blocking producer, throws std::system_error (eventfd) or std::length_error (no slot left)
+    size_t register_waiter() {
+        std::lock_guard<std::mutex> lock(register_mtx);
+        if (!free_slots.empty()) {
+            size_t reused = free_slots.back();
+            free_slots.pop_back();
+            return reused;
+        }
+        size_t slot = registered.load(std::memory_order_relaxed);
+        if (slot == max_waiters) {
+            throw std::length_error("queue space notifier: too many waiters");
+        }
+        int tmp_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (tmp_fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "eventfd failed ");
+        }
+        waiters[slot].efd.reset(tmp_fd);
+        registered.store(slot + 1, std::memory_order_release);
+        return slot;
+    }
+
+    // the producer is done with the slot (worker destroyed)
+    void release_waiter(size_t slot) {
+        disarm(slot);
+        std::lock_guard<std::mutex> lock(register_mtx);
+        free_slots.push_back(slot);
+    }
+
+    int fd(size_t slot) const {
+        return waiters[slot].efd.get();
+    }
+
+    // producer, re-check the occupancy afterwards
+    void arm(size_t slot) {
+        if (!waiters[slot].armed.exchange(true, std::memory_order_relaxed)) {
+            armed_count.fetch_add(1, std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    // producer, no longer waiting (woken, or resumed on its own), clears a pending wakeup
+    void disarm(size_t slot) {
+        if (waiters[slot].armed.exchange(false, std::memory_order_relaxed)) {
+            armed_count.fetch_sub(1, std::memory_order_relaxed);
+        }
+        uint64_t v;
+        (void)read(waiters[slot].efd.get(), &v, sizeof(v));
+    }
+
+    // consumer, after a successful pop (occupancy() = items left)
+    template <typename Occupancy>
+    void consumed(Occupancy &&occupancy) {
+        if (occupancy() > low_water.load(std::memory_order_relaxed)) {
+            if (!above_low_water.load(std::memory_order_relaxed)) {
+                above_low_water.store(true, std::memory_order_relaxed);
+            }
+            return;
+        }
+        if (!above_low_water.load(std::memory_order_relaxed) && armed_count.load(std::memory_order_relaxed) == 0) {
+            //below the mark since the last crossing, that pop already did the check
+            return;
+        }
+        above_low_water.store(false, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (armed_count.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        notify_all();
+    }
+
+    // wakes every armed producer (also used on shutdown)
+    void notify_all() {
+        size_t n = registered.load(std::memory_order_acquire);
+        for (size_t i = 0; i < n; i++) {
+            if (waiters[i].armed.exchange(false, std::memory_order_relaxed)) {
+                armed_count.fetch_sub(1, std::memory_order_relaxed);
+                uint64_t one = 1;
+                (void)write(waiters[i].efd.get(), &one, sizeof(one));
+                notifications.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // throws std::invalid_argument above capacity - 2
+    void set_low_water(size_t mark) {
+        if (mark > max_low_water) {
+            throw std::invalid_argument("illegal low water mark");
+        }
+        low_water.store(mark, std::memory_order_relaxed);
+    }
+
+    size_t low_water_mark() const { return low_water.load(std::memory_order_relaxed); }
+
+    // wakeups sent to producers
+    size_t notification_count() const { return notifications.load(std::memory_order_relaxed); }
+};
+
+#endif
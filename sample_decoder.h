@@ -0,0 +1,352 @@
+#ifndef _SAMPLE_DECODER_H_
+#define _SAMPLE_DECODER_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <memory>
+#include <stdexcept>
+#include "measurement.h"
+#include "measurement_batch.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SAMPLE_DECODER_X86 1
+#endif
+
+/*
+    Payload -> typed samples: packed int16 / int24 / int32, little or big endian,
+    value = raw * scale + offset, as float or as fixed point int32 (value * 2^frac_bits, rounded to nearest).
+
+    Schema, one per sensor, compact text form:
+        "i16le"              int16 little endian, scale 1, offset 0
+        "i24be*0.001"        int24 big endian, scale 0.001
+        "i32le*0.5-40"       int32 little endian, scale 0.5, offset -40
+    Trailing bytes that do not form a whole sample are ignored (same rule as aggregation_stage).
+
+    Kernels:
+    - AVX2 + FMA (x86, picked at run time with __builtin_cpu_supports, no build flags needed):
+      8 samples per step, byte swap and int24 unpacking with one pshufb, sign extension with
+      vpmovsxwd (int16) or an arithmetic shift (int24), int -> float, one FMA for scale + offset
+    - scalar reference (other CPUs, tails): one sample at a time, std::fma so both kernels give
+      bit identical results whatever CPU runs the pipeline
+    int32 samples beyond 2^24 lose precision in float (both kernels). Fixed point values outside
+    the int32 range give INT32_MIN (the x86 conversion result, mirrored by the scalar kernel).
+
+    Usage:
+    - in the worker: sensor_config::decode_schema, the payload is replaced by packed native float32
+      samples before the push (after aggregation when both are enabled)
+    - at the consumer: sample_decode_table::decode_batch() over a measurement_batch, or one decode()
+      per measurement (e.g. a stage_graph transform)
+*/
+
+enum class sample_encoding { INT16, INT24, INT32 };
+enum class sample_byte_order { LITTLE, BIG };
+enum class decode_kernel { AUTO, SCALAR, AVX2 };
+
+struct sample_schema {
+    sample_encoding encoding = sample_encoding::INT16;
+    sample_byte_order order = sample_byte_order::LITTLE;
+    float scale = 1.0f;
+    float offset = 0.0f;
+
+    size_t sample_bytes() const {
+        switch (encoding) {
+        case sample_encoding::INT16: return 2;
+        case sample_encoding::INT24: return 3;
+        default: return 4;
+        }
+    }
+
+    // compact text form (see above), throws std::invalid_argument
+    static sample_schema parse(std::string_view text) {
+        sample_schema s;
+        std::string str(text);
+        if (str.size() < 5 || str[0] != 'i') {
+            throw std::invalid_argument("illegal sample schema");
+        }
+        std::string width = str.substr(1, 2);
+        if (width == "16") s.encoding = sample_encoding::INT16;
+        else if (width == "24") s.encoding = sample_encoding::INT24;
+        else if (width == "32") s.encoding = sample_encoding::INT32;
+        else throw std::invalid_argument("illegal sample schema");
+
+        std::string endian = str.substr(3, 2);
+        if (endian == "le") s.order = sample_byte_order::LITTLE;
+        else if (endian == "be") s.order = sample_byte_order::BIG;
+        else throw std::invalid_argument("illegal sample schema");
+
+        const char *p = str.c_str() + 5;
+        char *end = nullptr;
+        if (*p == '*') {
+            s.scale = std::strtof(p + 1, &end);
+            if (end == p + 1) {
+                throw std::invalid_argument("illegal sample schema");
+            }
+            p = end;
+        }
+        if (*p == '+' || *p == '-') {
+            s.offset = std::strtof(p, &end);
+            if (end == p) {
+                throw std::invalid_argument("illegal sample schema");
+            }
+            p = end;
+        }
+        if (*p != '\0') {
+            throw std::invalid_argument("illegal sample schema");
+        }
+        return s;
+    }
+};
+
+namespace sample_kernels {
+
+    inline int32_t raw_sample(const uint8_t *p, sample_encoding enc, sample_byte_order order) {
+        bool le = order == sample_byte_order::LITTLE;
+        switch (enc) {
+        case sample_encoding::INT16:
+            return static_cast<int16_t>(static_cast<uint16_t>(le ? (p[0] | (p[1] << 8)) : (p[1] | (p[0] << 8))));
+        case sample_encoding::INT24: {
+            uint32_t v = le ? (p[0] | (p[1] << 8) | (static_cast<uint32_t>(p[2]) << 16)) : (p[2] | (p[1] << 8) | (static_cast<uint32_t>(p[0]) << 16));
+            return static_cast<int32_t>(v << 8) >> 8;
+        }
+        default: {
+            uint32_t v = le ? (p[0] | (p[1] << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24))
+                            : (p[3] | (p[2] << 8) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[0]) << 24));
+            return static_cast<int32_t>(v);
+        }
+        }
+    }
+
+    // cvtps2dq semantics: round to nearest even, out of range => INT32_MIN
+    inline int32_t to_fixed(float v) {
+        if (!(v >= -2147483648.0f && v < 2147483648.0f)) {
+            return INT32_MIN;
+        }
+        return static_cast<int32_t>(std::nearbyint(v));
+    }
+
+    // reference kernel, samples [first, count)
+    inline void scalar_f32(const uint8_t *p, size_t first, size_t count, sample_encoding enc, sample_byte_order order, float mul, float add, float *out) {
+        size_t w = (enc == sample_encoding::INT16) ? 2 : (enc == sample_encoding::INT24) ? 3 : 4;
+        for (size_t i = first; i < count; i++) {
+            out[i] = std::fma(static_cast<float>(raw_sample(p + i * w, enc, order)), mul, add);
+        }
+    }
+
+    inline void scalar_fixed(const uint8_t *p, size_t first, size_t count, sample_encoding enc, sample_byte_order order, float mul, float add, int32_t *out) {
+        size_t w = (enc == sample_encoding::INT16) ? 2 : (enc == sample_encoding::INT24) ? 3 : 4;
+        for (size_t i = first; i < count; i++) {
+            out[i] = to_fixed(std::fma(static_cast<float>(raw_sample(p + i * w, enc, order)), mul, add));
+        }
+    }
+
+#ifdef SAMPLE_DECODER_X86
+    inline bool avx2_supported() {
+        static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return supported;
+    }
+
+    // 8 raw samples starting at p, sign extended to int32
+    __attribute__((target("avx2,fma"))) inline __m256i load8(const uint8_t *p, sample_encoding enc, sample_byte_order order) {
+        bool be = order == sample_byte_order::BIG;
+        switch (enc) {
+        case sample_encoding::INT16: {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            if (be) {
+                v = _mm_shuffle_epi8(v, _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14));
+            }
+            return _mm256_cvtepi16_epi32(v);
+        }
+        case sample_encoding::INT24: {
+            //4 samples (12 bytes) per 128 bit lane, each moved to the top 3 bytes of an int32, then >> 8 (arithmetic)
+            __m256i v = _mm256_set_m128i(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+            const __m256i le_mask = _mm256_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+                                                     -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+            const __m256i be_mask = _mm256_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9,
+                                                     -1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9);
+            v = _mm256_shuffle_epi8(v, be ? be_mask : le_mask);
+            return _mm256_srai_epi32(v, 8);
+        }
+        default: {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            if (be) {
+                v = _mm256_shuffle_epi8(v, _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                                            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+            }
+            return v;
+        }
+        }
+    }
+
+    // samples the vector loop may touch: an int24 step loads 4 bytes past its 24
+    inline size_t avx2_samples(size_t count, size_t payload_bytes, sample_encoding enc) {
+        if (enc != sample_encoding::INT24) {
+            return count & ~size_t(7);
+        }
+        size_t n = count & ~size_t(7);
+        while (n > 0 && n * 3 + 4 > payload_bytes) {
+            n -= 8;
+        }
+        return n;
+    }
+
+    // returns the samples decoded (a multiple of 8), the caller finishes the tail with the scalar kernel
+    __attribute__((target("avx2,fma"))) inline size_t avx2_f32(const uint8_t *p, size_t count, size_t payload_bytes, sample_encoding enc, sample_byte_order order, float mul, float add, float *out) {
+        size_t w = (enc == sample_encoding::INT16) ? 2 : (enc == sample_encoding::INT24) ? 3 : 4;
+        size_t n = avx2_samples(count, payload_bytes, enc);
+        __m256 vmul = _mm256_set1_ps(mul);
+        __m256 vadd = _mm256_set1_ps(add);
+        for (size_t i = 0; i < n; i += 8) {
+            __m256 f = _mm256_cvtepi32_ps(load8(p + i * w, enc, order));
+            _mm256_storeu_ps(out + i, _mm256_fmadd_ps(f, vmul, vadd));
+        }
+        return n;
+    }
+
+    __attribute__((target("avx2,fma"))) inline size_t avx2_fixed(const uint8_t *p, size_t count, size_t payload_bytes, sample_encoding enc, sample_byte_order order, float mul, float add, int32_t *out) {
+        size_t w = (enc == sample_encoding::INT16) ? 2 : (enc == sample_encoding::INT24) ? 3 : 4;
+        size_t n = avx2_samples(count, payload_bytes, enc);
+        __m256 vmul = _mm256_set1_ps(mul);
+        __m256 vadd = _mm256_set1_ps(add);
+        for (size_t i = 0; i < n; i += 8) {
+            __m256 f = _mm256_fmadd_ps(_mm256_cvtepi32_ps(load8(p + i * w, enc, order)), vmul, vadd);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_cvtps_epi32(f));
+        }
+        return n;
+    }
+#else
+    inline bool avx2_supported() { return false; }
+#endif
+}
+
+class sample_decoder
+{
+private:
+    sample_schema schema;
+    bool use_avx2;
+
+public:
+    // throws std::invalid_argument when AVX2 is requested and the CPU does not have it
+    sample_decoder(const sample_schema &s, decode_kernel kernel = decode_kernel::AUTO) : schema(s), use_avx2(false) {
+        if (kernel == decode_kernel::AVX2 && !sample_kernels::avx2_supported()) {
+            throw std::invalid_argument("AVX2 decode kernel not supported on this CPU");
+        }
+        use_avx2 = (kernel != decode_kernel::SCALAR) && sample_kernels::avx2_supported();
+    }
+
+    size_t sample_count(size_t payload_bytes) const {
+        return payload_bytes / schema.sample_bytes();
+    }
+
+    // out must hold sample_count(payload.size()) floats, returns the samples written
+    size_t decode(std::span<const uint8_t> payload, float *out) const {
+        size_t count = sample_count(payload.size());
+        size_t done = 0;
+#ifdef SAMPLE_DECODER_X86
+        if (use_avx2) {
+            done = sample_kernels::avx2_f32(payload.data(), count, payload.size(), schema.encoding, schema.order, schema.scale, schema.offset, out);
+        }
+#endif
+        sample_kernels::scalar_f32(payload.data(), done, count, schema.encoding, schema.order, schema.scale, schema.offset, out);
+        return count;
+    }
+
+    // fixed point: round((raw * scale + offset) * 2^frac_bits)
+    size_t decode_fixed(std::span<const uint8_t> payload, unsigned frac_bits, int32_t *out) const {
+        size_t count = sample_count(payload.size());
+        float unit = std::ldexp(1.0f, static_cast<int>(frac_bits));
+        float mul = schema.scale * unit;
+        float add = schema.offset * unit;
+        size_t done = 0;
+#ifdef SAMPLE_DECODER_X86
+        if (use_avx2) {
+            done = sample_kernels::avx2_fixed(payload.data(), count, payload.size(), schema.encoding, schema.order, mul, add, out);
+        }
+#endif
+        sample_kernels::scalar_fixed(payload.data(), done, count, schema.encoding, schema.order, mul, add, out);
+        return count;
+    }
+
+    void decode(std::span<const uint8_t> payload, std::vector<float> &out) const {
+        out.resize(sample_count(payload.size()));
+        decode(payload, out.data());
+    }
+
+    // replaces the payload with packed native float32 samples (worker side decode), scratch is reused
+    void decode_payload(measurement &meas, std::vector<float> &scratch) const {
+        decode(std::span<const uint8_t>(meas.payload), scratch);
+        meas.payload.resize(scratch.size() * sizeof(float));
+        std::memcpy(meas.payload.data(), scratch.data(), meas.payload.size());
+    }
+
+    const sample_schema& get_schema() const { return schema; }
+    bool simd() const { return use_avx2; }
+};
+
+/*
+    Decoded samples of a measurement_batch, same layout idea:
+        samples of item i = samples[offsets[i] .. offsets[i + 1])
+    Items of sensors without a schema have no samples.
+*/
+struct decoded_batch {
+    std::vector<float> samples;
+    std::vector<uint32_t> offsets{0};
+
+    void clear() {
+        samples.clear();
+        offsets.resize(1);
+    }
+
+    std::span<const float> item(size_t i) const {
+        return std::span<const float>(samples.data() + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+};
+
+// per sensor decoders for the consumer side
+class sample_decode_table
+{
+private:
+    std::vector<std::unique_ptr<sample_decoder>> decoders; //index: sensor_id
+    decode_kernel kernel;
+
+public:
+    sample_decode_table(decode_kernel k = decode_kernel::AUTO) : kernel(k) {}
+
+    void set(size_t sensor_id, const sample_schema &schema) {
+        if (sensor_id >= decoders.size()) {
+            decoders.resize(sensor_id + 1);
+        }
+        decoders[sensor_id] = std::make_unique<sample_decoder>(schema, kernel);
+    }
+
+    const sample_decoder* find(size_t sensor_id) const {
+        return (sensor_id < decoders.size()) ? decoders[sensor_id].get() : nullptr;
+    }
+
+    // appends to out (call out.clear() to reuse it), out.offsets gets one entry per batch item
+    void decode_batch(const measurement_batch &batch, decoded_batch &out) const {
+        size_t total = 0;
+        for (size_t i = 0; i < batch.size(); i++) {
+            const sample_decoder *d = find(batch.sensor_ids[i]);
+            total += (d != nullptr) ? d->sample_count(batch.payload(i).size()) : 0;
+        }
+
+        size_t pos = out.samples.size();
+        out.samples.resize(pos + total);
+        for (size_t i = 0; i < batch.size(); i++) {
+            const sample_decoder *d = find(batch.sensor_ids[i]);
+            if (d != nullptr) {
+                pos += d->decode(batch.payload(i), out.samples.data() + pos);
+            }
+            out.offsets.push_back(static_cast<uint32_t>(pos));
+        }
+    }
+};
+
+#endif
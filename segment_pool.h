@@ -0,0 +1,202 @@
+#ifndef _SEGMENT_POOL_H_
+#define _SEGMENT_POOL_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <span>
+#include <stdexcept>
+#include "memory_policy.h"
+
+/*
+    Fixed size receive segments for the zero-copy path (see zero_copy_worker.h).
+
+    The source reads straight into a segment, the scanner finds frames in place, and every frame
+    is published as a frame_view (segment, offset, length) instead of a copied payload.
+
+    Reference counting:
+    - the worker holds one reference on the segment it is reading into
+    - every frame_view holds one reference
+    - when the count drops to 0 (worker moved on and every view was released) the segment goes
+      back to the free list and can be read into again
+
+    acquire() returns nullptr when every segment is in use (consumers hold too many views),
+    counted in exhausted_count().
+    acquire() / release() may be called from any thread. The free list is a mutex protected stack,
+    it is touched once per segment, not per frame.
+
+    Lifetime: the segment memory and free list live in a segment_pool_state shared by the pool and
+    every segment that is out of the free list. Views still queued after shutdown (or destroyed by the
+    queue after the pool) stay valid, the state is freed by whichever goes last: the pool or the
+    release of the last acquired segment. Like the free list, the share is taken once per segment.
+*/
+
+struct segment_pool_state;
+
+struct rx_segment {
+    uint8_t *data = nullptr;
+    size_t capacity = 0;
+    size_t used = 0; //bytes written by the worker, only the worker touches it
+    std::atomic<uint32_t> refs{0};
+    segment_pool_state *pool = nullptr;
+};
+
+/*
+    Read only view of one frame payload inside an rx_segment.
+    Move only, the destructor (or reset()) releases the segment reference.
+*/
+class frame_view
+{
+private:
+    rx_segment *seg;
+    uint32_t off;
+    uint32_t len;
+
+public:
+    frame_view() : seg(nullptr), off(0), len(0) {}
+
+    // takes a new reference on segment
+    frame_view(rx_segment *segment, size_t offset, size_t length) : seg(segment), off(static_cast<uint32_t>(offset)), len(static_cast<uint32_t>(length)) {
+        seg->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    frame_view(frame_view &&rhs) noexcept : seg(rhs.seg), off(rhs.off), len(rhs.len) {
+        rhs.seg = nullptr;
+        rhs.len = 0;
+    }
+
+    frame_view& operator=(frame_view &&rhs) noexcept {
+        if (this != &rhs) {
+            reset();
+            seg = rhs.seg;
+            off = rhs.off;
+            len = rhs.len;
+            rhs.seg = nullptr;
+            rhs.len = 0;
+        }
+        return *this;
+    }
+
+    frame_view(const frame_view&) = delete;
+    frame_view& operator=(const frame_view&) = delete;
+
+    ~frame_view() {
+        reset();
+    }
+
+    inline void reset();
+
+    bool valid() const { return seg != nullptr; }
+    const uint8_t* data() const { return seg->data + off; }
+    size_t size() const { return len; }
+    std::span<const uint8_t> bytes() const { return valid() ? std::span<const uint8_t>(data(), len) : std::span<const uint8_t>(); }
+};
+
+struct segment_pool_state
+{
+    size_t seg_size;
+    size_t seg_count;
+    std::vector<uint8_t, policy_allocator<uint8_t>> storage;
+    std::unique_ptr<rx_segment[]> segments;
+    std::mutex free_mtx;
+    std::vector<rx_segment*> free_list;
+    std::atomic<size_t> exhausted;
+    std::atomic<size_t> holders; //the pool + every segment out of the free list
+
+    segment_pool_state(size_t segment_count, size_t segment_size, const memory_policy &policy) : seg_size(segment_size), seg_count(segment_count), storage(policy_allocator<uint8_t>(policy)), segments(new rx_segment[segment_count]), exhausted(0), holders(1) {
+        storage.resize(segment_count * segment_size);
+        free_list.reserve(segment_count);
+        for (size_t i = 0; i < segment_count; i++) {
+            segments[i].data = storage.data() + i * segment_size;
+            segments[i].capacity = segment_size;
+            segments[i].pool = this;
+            free_list.push_back(&segments[i]);
+        }
+    }
+
+    // drops one share, the last one frees the state
+    void unhold() {
+        if (holders.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    // drops one reference, the segment is recycled when it was the last one
+    void release(rx_segment *seg) {
+        if (seg->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(free_mtx);
+            free_list.push_back(seg);
+        }
+        unhold();
+    }
+};
+
+class segment_pool
+{
+private:
+    segment_pool_state *state;
+
+public:
+    // policy: NUMA node / huge pages for the segment memory (see memory_policy.h)
+    segment_pool(size_t segment_count, size_t segment_size, const memory_policy &policy = {}) : state(nullptr) {
+        if (segment_count == 0 || segment_size == 0 || segment_size > UINT32_MAX) {
+            throw std::invalid_argument("illegal segment pool size");
+        }
+        state = new segment_pool_state(segment_count, segment_size, policy);
+    }
+
+    // the state outlives the pool while segments are still referenced (queued views)
+    ~segment_pool() {
+        state->unhold();
+    }
+
+    segment_pool(const segment_pool&) = delete;
+    segment_pool& operator=(const segment_pool&) = delete;
+
+    // the returned segment is empty and holds one reference (the caller's)
+    rx_segment* acquire() {
+        std::lock_guard<std::mutex> lock(state->free_mtx);
+        if (state->free_list.empty()) {
+            state->exhausted.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        rx_segment *seg = state->free_list.back();
+        state->free_list.pop_back();
+        state->holders.fetch_add(1, std::memory_order_relaxed);
+        seg->used = 0;
+        seg->refs.store(1, std::memory_order_relaxed);
+        return seg;
+    }
+
+    // drops one reference, the segment is recycled when it was the last one
+    void release(rx_segment *seg) {
+        state->release(seg);
+    }
+
+    size_t free_count() {
+        std::lock_guard<std::mutex> lock(state->free_mtx);
+        return state->free_list.size();
+    }
+
+    // acquire() calls that found no free segment
+    size_t exhausted_count() const { return state->exhausted.load(std::memory_order_relaxed); }
+
+    size_t segment_size() const { return state->seg_size; }
+    size_t segment_count() const { return state->seg_count; }
+};
+
+inline void frame_view::reset() {
+    if (seg != nullptr) {
+        seg->pool->release(seg);
+        seg = nullptr;
+        len = 0;
+    }
+}
+
+#endif
@@ -0,0 +1,294 @@
+#ifndef _SENSOR_EXECUTOR_H_
+#define _SENSOR_EXECUTOR_H_
+
+#include <coroutine>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <span>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "unique_fd.h"
+#include "sensor_source.h"
+
+/*
+    sensor_executor: a small pool of epoll event loops that run sensor worker coroutines.
+
+    Instead of one thread blocked in read_bytes() per sensor, every sensor is a coroutine
+    that does `co_await reader.read(span)`. The coroutine is suspended while its source has
+    no data and resumed by the loop thread when one of the source's pollable_fds()
+    (data fd / stop eventfd) becomes readable.
+
+    Threading model:
+    - each loop is single threaded: a coroutine always runs on the loop it was posted to
+    - post() is the only call that may be used from other threads
+    - workers must be stopped before the executor is destroyed (a suspended coroutine
+      can only finish if its loop is still running)
+*/
+
+class sensor_executor
+{
+public:
+    class loop;
+
+    //one per suspended coroutine, registered in epoll as event data
+    struct io_waiter {
+        std::coroutine_handle<> h;
+    };
+
+    /*
+        Keeps the source fds registered (level-triggered) for the whole life of the worker
+        coroutine, so a wait costs no epoll_ctl calls.
+        Must live inside the coroutine frame that awaits on it.
+    */
+    class async_reader
+    {
+    private:
+        // after this many reads without suspending the coroutine yields, so one chatty sensor cannot starve the loop
+        static constexpr size_t max_reads_per_wakeup = 16;
+        loop &lp;
+        sensor_source &src;
+        std::vector<int> fds;
+        io_waiter waiter;
+        size_t burst;
+
+    public:
+        async_reader(loop &l, sensor_source &s) : lp(l), src(s), fds(s.pollable_fds()), burst(0) {
+            if (fds.empty()) {
+                throw std::invalid_argument("sensor source does not support async reads");
+            }
+            for (int fd : fds) {
+                lp.watch(fd, &waiter);
+            }
+        }
+
+        ~async_reader() {
+            for (int fd : fds) {
+                lp.unwatch(fd, &waiter);
+            }
+        }
+
+        async_reader(const async_reader&) = delete;
+        async_reader& operator=(const async_reader&) = delete;
+
+        struct read_awaitable {
+            async_reader &rd;
+            std::span<uint8_t> buf;
+            ssize_t result;
+            bool yielded;
+
+            bool await_ready() {
+                if (rd.burst >= max_reads_per_wakeup) {
+                    return false;
+                }
+                result = rd.src.try_read_bytes(buf.data(), buf.size());
+                if (result == sensor_source::would_block) {
+                    return false;
+                }
+                rd.burst++;
+                return true;
+            }
+
+            void await_suspend(std::coroutine_handle<> h) {
+                rd.burst = 0;
+                if (yielded) {
+                    //data may still be pending: go to the back of the ready list
+                    rd.lp.post(h);
+                    return;
+                }
+                rd.waiter.h = h;
+            }
+
+            /*
+                Returns the read_bytes() contract, plus sensor_source::would_block on a spurious
+                wakeup (the caller simply awaits again).
+            */
+            ssize_t await_resume() {
+                if (result == sensor_source::would_block || yielded) {
+                    result = rd.src.try_read_bytes(buf.data(), buf.size());
+                }
+                return result;
+            }
+        };
+
+        read_awaitable read(std::span<uint8_t> buf) {
+            return read_awaitable{*this, buf, sensor_source::would_block, burst >= max_reads_per_wakeup};
+        }
+    };
+
+    class loop
+    {
+    private:
+        static constexpr int max_events = 64;
+        unique_fd epfd;
+        unique_fd wake_fd;
+        std::mutex m;
+        std::vector<std::coroutine_handle<>> posted;
+        std::vector<io_waiter*> retired; //waiters unregistered while a batch of events is dispatched
+        std::atomic<bool> stop_req;
+        std::thread loop_thread;
+
+        void drain_wake_fd() {
+            uint64_t v;
+            while (read(wake_fd.get(), &v, sizeof(v)) == sizeof(v)) {
+            }
+        }
+
+        void run_posted() {
+            std::vector<std::coroutine_handle<>> ready;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                ready.swap(posted);
+            }
+            for (auto h : ready) {
+                h.resume();
+            }
+        }
+
+        void run() {
+            epoll_event events[max_events];
+
+            while (!stop_req.load(std::memory_order_acquire)) {
+                int n = epoll_wait(epfd.get(), events, max_events, -1);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    break;
+                }
+
+                for (int i = 0; i < n; i++) {
+                    io_waiter *w = static_cast<io_waiter*>(events[i].data.ptr);
+                    if (w == nullptr) {
+                        drain_wake_fd();
+                        continue;
+                    }
+                    //coroutine ended earlier in this batch, its waiter is gone
+                    if (std::find(retired.begin(), retired.end(), w) != retired.end()) {
+                        continue;
+                    }
+                    //both fds of one source can fire in the same batch, resume only once
+                    if (!w->h) {
+                        continue;
+                    }
+                    std::coroutine_handle<> h = w->h;
+                    w->h = {};
+                    h.resume();
+                }
+                retired.clear();
+
+                run_posted();
+            }
+        }
+
+    public:
+        loop() : stop_req(false) {
+            int tmp_fd = epoll_create1(EPOLL_CLOEXEC);
+            if (tmp_fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "epoll_create1 failed ");
+            }
+            epfd.reset(tmp_fd);
+
+            tmp_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (tmp_fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "eventfd failed ");
+            }
+            wake_fd.reset(tmp_fd);
+
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.ptr = nullptr;
+            if (epoll_ctl(epfd.get(), EPOLL_CTL_ADD, wake_fd.get(), &ev) != 0) {
+                throw std::system_error(errno, std::generic_category(), "epoll_ctl failed ");
+            }
+
+            loop_thread = std::thread(&loop::run, this);
+        }
+
+        ~loop() {
+            stop();
+        }
+
+        loop(const loop&) = delete;
+        loop& operator=(const loop&) = delete;
+
+        void watch(int fd, io_waiter *w) {
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.ptr = w;
+            if (epoll_ctl(epfd.get(), EPOLL_CTL_ADD, fd, &ev) != 0) {
+                throw std::system_error(errno, std::generic_category(), "epoll_ctl failed ");
+            }
+        }
+
+        // loop thread only
+        void unwatch(int fd, io_waiter *w) {
+            epoll_ctl(epfd.get(), EPOLL_CTL_DEL, fd, nullptr);
+            retired.push_back(w);
+        }
+
+        //thread safe: schedule h to be resumed on the loop thread
+        void post(std::coroutine_handle<> h) {
+            {
+                std::unique_lock<std::mutex> lock(m);
+                posted.push_back(h);
+            }
+            uint64_t v = 1;
+            write(wake_fd.get(), &v, sizeof(v));
+        }
+
+        void stop() {
+            if (stop_req.exchange(true)) {
+                return;
+            }
+            uint64_t v = 1;
+            write(wake_fd.get(), &v, sizeof(v));
+            if (loop_thread.joinable()) {
+                loop_thread.join();
+            }
+        }
+    };
+
+private:
+    std::vector<std::unique_ptr<loop>> loops;
+    size_t next;
+
+public:
+    // thread_count must be larger then 0
+    sensor_executor(size_t thread_count) : next(0) {
+        if (thread_count == 0) {
+            throw std::invalid_argument("illegal executor thread count");
+        }
+        for (size_t i = 0; i < thread_count; i++) {
+            loops.push_back(std::make_unique<loop>());
+        }
+    }
+
+    ~sensor_executor() {
+        stop();
+    }
+
+    size_t thread_count() const { return loops.size(); }
+
+    //round robin placement of sensors on loops, called from the control thread only
+    loop& next_loop() {
+        loop &lp = *loops[next];
+        next = (next + 1) == loops.size() ? 0 : next + 1;
+        return lp;
+    }
+
+    void stop() {
+        for (auto &lp : loops) {
+            lp->stop();
+        }
+    }
+};
+
+#endif
@@ -1,15 +1,30 @@
 #include <iostream>
 #include <vector>
 #include <memory>
+#include <string>
 #include "sensor_source.h"
 #include "uart_sensor_source.h"
 #include "fake_sensor_source.h"
 #include "sensor_worker.h"
+#include "seqpacket_source.h"
+#include "udp_sensor_source.h"
+#include "packet_worker.h"
+#include "queue_concept.h"
 #include "lockless_global_queue.h"
+#include "locking_global_queue.h"
 #include "frame_parser.h"
 #include "uart_frame_parser.h"
 #include "fake_frame_parser.h"
+#include "cobs_frame_parser.h"
+#include "slip_frame_parser.h"
 #include "measurement.h"
+#include "aggregation_stage.h"
+#include "memory_budget.h"
+#include "latest_value_table.h"
+#include "sample_decoder.h"
+#include "tracer.h"
+#include "perf_counters.h"
+#include "stage_graph.h"
 
 
 enum class sensor_type {
@@ -17,48 +32,241 @@ enum class sensor_type {
     GPIO,
     I2C,
     SPI,
-    FAKE
+    FAKE,
+    SEQPACKET, //packetized, local device daemon over AF_UNIX SOCK_SEQPACKET
+    UDP //packetized, sensor gateway datagrams
+};
+
+//framing of the byte stream (UART sensors)
+enum class frame_format {
+    SYNC_LEN_CRC,
+    COBS,
+    SLIP
 };
 
 struct sensor_config {
     sensor_type type;
     size_t stream_buffer_size;
     uart_config uart_conf; //only use for uart sensors
+    frame_format framing = frame_format::SYNC_LEN_CRC; //only use for uart sensors
+    delimited_parser_config delimited_conf{}; //only use for COBS / SLIP framing
+    uart_parser_config parser_conf{}; //only use for SYNC_LEN_CRC framing
+    aggregation_config aggregation{}; //optional decimation / windowed aggregation before enqueue
+    memory_policy buffer_policy{}; //NUMA node / huge pages for the stream buffer
+    seqpacket_config seqpacket_conf{}; //only use for SEQPACKET sensors
+    udp_config udp_conf{}; //only use for UDP sensors (one sensor per socket, reuseport for fan-out)
+    packet_validator validator{}; //optional, only use for SEQPACKET / UDP sensors
+    std::string decode_schema{}; //optional, e.g. "i24be*0.001" (sample_decoder.h): payload pushed as float32 samples, only use for UART / FAKE sensors; with a WINDOW aggregation it must be little-endian with aggregation.sample_width bytes
 };
 
+/*
+    Queue: global queue backend (queue_concept.h)
+        sensor_manager<> mgr(1024);                                      //lockless (default)
+        sensor_manager<locking_global_queue<measurement>> mgr(1024);     //mutex
+        sensor_manager<ticket_global_queue<measurement>> mgr(1024);      //ticket admission, single consumer
+*/
+template <measurement_queue Queue = lockless_global_queue<measurement>>
 class sensor_manager {
 private:
     size_t sensor_id;
-    global_queue<measurement> g_queue;
+    memory_budget budget;
+    Queue g_queue;
+    std::unique_ptr<latest_value_table> latest_values; //optional, see enable_latest_values(), outlives the workers
     std::vector<std::unique_ptr<sensor_source>> sensor_sources;
     std::vector<std::unique_ptr<frame_parser>> frame_parsers;
-    std::vector<std::unique_ptr<sensor_worker>> sensor_workers;
+    std::vector<std::unique_ptr<aggregation_stage>> aggregation_stages;
+    std::vector<std::unique_ptr<sample_decoder>> sample_decoders;
+    std::vector<std::unique_ptr<sensor_worker<Queue>>> sensor_workers;
+    std::vector<std::unique_ptr<packet_source>> packet_sources;
+    std::vector<std::unique_ptr<packet_worker<Queue>>> packet_workers;
     std::atomic<bool> stopped{false};
 
+    static std::unique_ptr<frame_parser> make_parser(const sensor_config& s_config) {
+        switch (s_config.framing)
+        {
+        case frame_format::COBS:
+            return std::make_unique<cobs_frame_parser>(s_config.delimited_conf);
+        case frame_format::SLIP:
+            return std::make_unique<slip_frame_parser>(s_config.delimited_conf);
+        default:
+            return std::make_unique<uart_frame_parser>(s_config.parser_conf);
+        }
+    }
+
+    /*
+        The decoder runs on the aggregation output. A WINDOW stage folds little-endian signed samples of
+        sample_width bytes and encodes the result the same way, so the schema has to read exactly those
+        samples, and a negative scale would turn the MIN of the raw samples into the MAX of the decoded ones.
+        KEEP_EVERY_NTH and suppress_unchanged forward payloads unchanged, any schema fits.
+    */
+    static sample_schema parse_decode_schema(const sensor_config& s_config) {
+        sample_schema schema = sample_schema::parse(s_config.decode_schema);
+        const aggregation_config &aggr = s_config.aggregation;
+        if (aggr.mode != aggregation_mode::WINDOW) {
+            return schema;
+        }
+        if (schema.order != sample_byte_order::LITTLE || schema.sample_bytes() != aggr.sample_width) {
+            throw std::invalid_argument("decode_schema does not match the aggregation samples");
+        }
+        if (schema.scale < 0.0f && (aggr.func == window_function::MIN || aggr.func == window_function::MAX)) {
+            throw std::invalid_argument("negative decode_schema scale with a MIN / MAX aggregation");
+        }
+        return schema;
+    }
+
+    //packetized sensors skip the stream buffer and the parser (packet_worker.h)
+    void add_packet_sensor(const sensor_config& s_config) {
+        std::unique_ptr<packet_source> source;
+        if (s_config.type == sensor_type::UDP) {
+            source = std::make_unique<udp_sensor_source>(s_config.udp_conf);
+        }
+        else {
+            source = std::make_unique<seqpacket_source>(s_config.seqpacket_conf);
+        }
+        auto worker = std::make_unique<packet_worker<Queue>>(sensor_id, *source, g_queue, s_config.validator, &budget, latest_values.get());
+
+        //admission control
+        if (!budget.try_reserve(memory_category::STREAM_BUFFERS, worker->static_memory_bytes())) {
+            throw std::runtime_error("memory budget exceeded");
+        }
+
+        sensor_id++;
+        packet_sources.push_back(std::move(source));
+        packet_workers.push_back(std::move(worker));
+    }
+
 public:
-    sensor_manager(size_t global_q_capacity) : sensor_id(0), g_queue(global_q_capacity) {
+    /*
+        memory_budget_bytes: pipeline wide cap (0 => unlimited) on queue slots, stream/read buffers,
+        parser scratch and in-flight payload bytes (see memory_budget.h).
+        Throws if the global queue alone does not fit.
+    */
+    sensor_manager(size_t global_q_capacity, const memory_policy &queue_policy = {}, size_t memory_budget_bytes = 0) : sensor_id(0), budget(memory_budget_bytes), g_queue(global_q_capacity, queue_policy) {
+        if (!budget.try_reserve(memory_category::QUEUE_SLOTS, g_queue.capacity() * Queue::slot_bytes())) {
+            throw std::invalid_argument("memory budget too small for the global queue");
+        }
     }
 
     ~sensor_manager() {
         stop_all();
     }
 
+    // throws std::runtime_error if the sensor does not fit in the memory budget,
+    // std::invalid_argument for a bad decode_schema or one that does not fit the aggregation (nothing is added)
     void add_sensor(const sensor_config& s_config) {
+        std::unique_ptr<sensor_source> source;
+        std::unique_ptr<frame_parser> parser;
+        std::unique_ptr<aggregation_stage> aggregator;
+        std::unique_ptr<sample_decoder> decoder;
+
+        if (s_config.type == sensor_type::SEQPACKET || s_config.type == sensor_type::UDP) {
+            add_packet_sensor(s_config);
+            return;
+        }
+
         switch (s_config.type)
         {
         case sensor_type::UART:
-            sensor_sources.push_back(std::make_unique<uart_sensor_source>(s_config.uart_conf));
-            frame_parsers.push_back(std::make_unique<uart_frame_parser>());
-            sensor_workers.push_back(std::make_unique<sensor_worker>(s_config.stream_buffer_size, sensor_id++, *sensor_sources.back(), *frame_parsers.back(), g_queue));
+            source = std::make_unique<uart_sensor_source>(s_config.uart_conf);
+            parser = make_parser(s_config);
             break;
         case sensor_type::FAKE:
-            sensor_sources.push_back(std::make_unique<fake_sensor_source>());
-            frame_parsers.push_back(std::make_unique<fake_frame_parser>());
-            sensor_workers.push_back(std::make_unique<sensor_worker>(s_config.stream_buffer_size, sensor_id++, *sensor_sources.back(), *frame_parsers.back(), g_queue));
+            source = std::make_unique<fake_sensor_source>();
+            parser = std::make_unique<fake_frame_parser>();
             break;
         default:
             throw std::runtime_error("Unsupported sensor type");
         }
+
+        if (s_config.aggregation.enabled()) {
+            aggregator = std::make_unique<aggregation_stage>(s_config.aggregation);
+        }
+        if (!s_config.decode_schema.empty()) {
+            decoder = std::make_unique<sample_decoder>(parse_decode_schema(s_config));
+        }
+
+        auto worker = std::make_unique<sensor_worker<Queue>>(s_config.stream_buffer_size, sensor_id, *source, *parser, g_queue, aggregator.get(), s_config.buffer_policy, &budget, latest_values.get(), decoder.get());
+
+        //admission control
+        if (!budget.try_reserve(memory_category::STREAM_BUFFERS, worker->static_memory_bytes())) {
+            throw std::runtime_error("memory budget exceeded");
+        }
+        if (!budget.try_reserve(memory_category::PARSER_SCRATCH, parser->scratch_bytes())) {
+            budget.release(memory_category::STREAM_BUFFERS, worker->static_memory_bytes());
+            throw std::runtime_error("memory budget exceeded");
+        }
+
+        sensor_id++;
+        sensor_sources.push_back(std::move(source));
+        frame_parsers.push_back(std::move(parser));
+        if (aggregator) {
+            aggregation_stages.push_back(std::move(aggregator));
+        }
+        if (decoder) {
+            sample_decoders.push_back(std::move(decoder));
+        }
+        sensor_workers.push_back(std::move(worker));
+    }
+
+    /*
+        Consumer pop that also returns the payload bytes to the memory budget.
+        Consumers that pop from queue() directly must call release_payload() for each measurement
+        (batch_consumer / ordered_consumer do it when given budget()).
+    */
+    queue_status pop(measurement &meas) {
+        PERF_SCOPE(pop_perf, POP, perf_profiler::consumer);
+        queue_status q_status = g_queue.pop(meas);
+        if (q_status == queue_status::OK) {
+            TRACE_INSTANT(POP, meas.sensor_id, meas.payload.size());
+            PERF_FRAMES(perf_profiler::consumer, 1);
+            PERF_BYTES(perf_profiler::consumer, meas.payload.size());
+            release_payload(meas);
+        }
+        return q_status;
+    }
+
+    void release_payload(const measurement &meas) {
+        budget.release(memory_category::IN_FLIGHT_PAYLOAD, meas.payload.size());
+    }
+
+    /*
+        Newest measurement per sensor (latest_value_table.h) for readers that must not pop the queue.
+        Call once, before add_sensor(), sensors with an id >= max_sensors are not tracked.
+        Throws std::logic_error when called twice or after a sensor was added,
+        std::runtime_error when the table does not fit in the memory budget.
+    */
+    latest_value_table& enable_latest_values(size_t max_sensors, size_t max_payload_bytes = 64) {
+        if (latest_values || sensor_id != 0) {
+            throw std::logic_error("latest values must be enabled once, before the first sensor");
+        }
+        auto table = std::make_unique<latest_value_table>(max_sensors, max_payload_bytes);
+        if (!budget.try_reserve(memory_category::SNAPSHOT_TABLES, table->memory_bytes())) {
+            throw std::runtime_error("memory budget exceeded");
+        }
+        latest_values = std::move(table);
+        return *latest_values;
+    }
+
+    // nullptr unless enable_latest_values() was called
+    const latest_value_table* latest() const {
+        return latest_values.get();
+    }
+
+    memory_budget& get_budget() {
+        return budget;
+    }
+
+    /*
+        Consumer side processing graph over the global queue (payload bytes are released to the budget).
+        Add stages, start() it, and stop() / join() it before the manager is destroyed.
+    */
+    std::unique_ptr<stage_graph<Queue>> make_stage_graph(size_t batch_items = 32) {
+        return std::make_unique<stage_graph<Queue>>(g_queue, batch_items, &budget);
+    }
+
+    // consumer side access (pop / batch_consumer), producers are the workers
+    Queue& queue() {
+        return g_queue;
     }
 
     void start_all() {
@@ -66,6 +274,22 @@ public:
         for ( auto &worker : sensor_workers) {
             worker->start();
         }
+        for (auto &worker : packet_workers) {
+            worker->start();
+        }
+    }
+
+    // run every worker as a coroutine on the executor instead of a thread per sensor
+    // the executor must outlive the manager (or stop_all() must be called first)
+    void start_all(sensor_executor &executor) {
+
+        for ( auto &worker : sensor_workers) {
+            worker->start(executor);
+        }
+        //packet workers have no coroutine mode, they keep their own thread
+        for (auto &worker : packet_workers) {
+            worker->start();
+        }
     }
 
     void stop_all() {
@@ -76,6 +300,9 @@ public:
         for (auto &worker : sensor_workers) {
             worker->stop();
         }
+        for (auto &worker : packet_workers) {
+            worker->stop();
+        }
         g_queue.shutdown();
     }
 };
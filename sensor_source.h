@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <vector>
 #include <sys/types.h>
 
 class sensor_source
@@ -20,6 +21,39 @@ public:
     */     
     virtual ssize_t read_bytes(uint8_t* buf, size_t buf_len) = 0; //pure virtual (no impl)
     virtual int stop_request() = 0;
+
+    // read buffer size that suits this source (e.g. scaled with the line rate), 0 => worker default
+    virtual size_t preferred_read_size() const { return 0; }
+
+    /*
+        Non-blocking interface (used by sensor_executor, optional).
+        pollable_fds(): fds that become readable when try_read_bytes() can make progress
+                        (data arrived or stop requested). Empty => source is blocking only.
+        try_read_bytes(): same contract as read_bytes() but never blocks,
+                          returns would_block when there is nothing to read yet.
+    */
+    static constexpr ssize_t would_block = -2;
+
+    virtual std::vector<int> pollable_fds() const { return {}; }
+
+    virtual ssize_t try_read_bytes(uint8_t* buf, size_t buf_len) {
+        (void)buf;
+        (void)buf_len;
+        return -1;
+    }
+
+    /*
+        read_bytes() that also returns woken when wake_fd becomes readable (wake_fd is not drained).
+        Used by sensor_worker to resume parsing when the global queue has space again
+        (queue_space_notifier.h). Default: sources that cannot poll an extra fd ignore wake_fd,
+        the worker then resumes on the next bytes only.
+    */
+    static constexpr ssize_t woken = -3;
+
+    virtual ssize_t read_bytes_or_wake(uint8_t* buf, size_t buf_len, int wake_fd) {
+        (void)wake_fd;
+        return read_bytes(buf, buf_len);
+    }
 };
 
 #endif
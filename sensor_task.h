@@ -0,0 +1,111 @@
+#ifndef _SENSOR_TASK_H_
+#define _SENSOR_TASK_H_
+
+#include <coroutine>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <utility>
+
+/*
+    Coroutine return type for sensor workers that run on a sensor_executor.
+
+    - lazy: the body starts only when the executor resumes handle() for the first time
+    - the frame is kept alive after the body ends (final_suspend suspends),
+      the owner waits for completion and destroys it from its own thread
+    - an exception escaping the body terminates, same as an exception escaping a std::thread
+
+    completion lives outside the coroutine frame (shared_ptr) so the loop thread never
+    touches freed memory when the owner destroys the frame right after wait() returns.
+*/
+
+class sensor_task
+{
+private:
+    struct completion {
+        std::mutex m;
+        std::condition_variable cv;
+        bool finished = false;
+    };
+
+public:
+    struct promise_type {
+        std::shared_ptr<completion> done = std::make_shared<completion>();
+
+        struct final_awaiter {
+            bool await_ready() noexcept { return false; }
+
+            void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                //local copy: the frame (and h.promise()) may be destroyed as soon as the lock is released
+                std::shared_ptr<completion> c = h.promise().done;
+                std::unique_lock<std::mutex> lock(c->m);
+                c->finished = true;
+                c->cv.notify_all();
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        sensor_task get_return_object() {
+            return sensor_task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        final_awaiter final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    sensor_task() = default;
+
+    explicit sensor_task(std::coroutine_handle<promise_type> h) : handle_(h), done(h.promise().done) {
+    }
+
+    sensor_task(const sensor_task&) = delete;
+    sensor_task& operator=(const sensor_task&) = delete;
+
+    sensor_task(sensor_task&& rhs) noexcept : handle_(std::exchange(rhs.handle_, {})), done(std::move(rhs.done)) {
+    }
+
+    sensor_task& operator=(sensor_task&& rhs) noexcept {
+        if (this == &rhs) {
+            return *this;
+        }
+        reset();
+        handle_ = std::exchange(rhs.handle_, {});
+        done = std::move(rhs.done);
+        return *this;
+    }
+
+    ~sensor_task() {
+        reset();
+    }
+
+    bool valid() const { return static_cast<bool>(handle_); }
+
+    std::coroutine_handle<> handle() const { return handle_; }
+
+    //blocks the calling thread until the coroutine body has finished
+    void wait() const {
+        if (!done) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(done->m);
+        done->cv.wait(lock, [this]{ return done->finished; });
+    }
+
+    // frame must be finished (wait()) or never started before it is destroyed
+    void reset() {
+        if (handle_) {
+            handle_.destroy();
+            handle_ = {};
+        }
+        done.reset();
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+    std::shared_ptr<completion> done;
+};
+
+#endif
@@ -17,55 +17,267 @@
 #include <algorithm>
 #include <iostream>
 #include <vector>
+#include <span>
+#include <stdexcept>
 #include "stream_buffer.h"
 #include "frame_parser.h"
 #include "uart_frame_parser.h"
+#include "queue_concept.h"
 #include "lockless_global_queue.h"
 #include "sensor_source.h"
 #include "uart_sensor_source.h"
 #include "measurement.h"
+#include "sensor_task.h"
+#include "sensor_executor.h"
+#include "aggregation_stage.h"
+#include "memory_budget.h"
+#include "latest_value_table.h"
+#include "sample_decoder.h"
+#include "tracer.h"
+#include "perf_counters.h"
 
+// Queue: global queue backend (queue_concept.h), deduced from the constructor argument
+template <measurement_queue Queue = lockless_global_queue<measurement>>
 class sensor_worker {
 
     private:
-        static constexpr size_t MAX_SOURCE_READ_BUFFER = 256; //bytes
+        static constexpr size_t DEFAULT_SOURCE_READ_BUFFER = 256; //bytes, used when the source has no preferred_read_size()
         static constexpr size_t PARSER_CHUNK_SIZE = 64; //bytes
+        static constexpr size_t no_space_slot = static_cast<size_t>(-1);
+        static constexpr int no_space_wakeup = -2;
         stream_buffer st_buffer;
         size_t sensor_id;
         frame_parser &f_parser;
-        global_queue<measurement> &global_q;
+        Queue &global_q;
         sensor_source &s_source;
+        aggregation_stage *aggregator; //optional, nullptr => every frame is pushed
+        memory_budget *budget; //optional, nullptr => in-flight payload bytes are not accounted
+        latest_value_table *latest_values; //optional, nullptr => no latest value per sensor
+        const sample_decoder *decoder; //optional, nullptr => the raw payload is pushed
+        std::vector<float> decode_scratch;
         std::atomic<bool> stop_req;
         bool started;
         size_t read_errors;
         size_t eos_count;
         size_t stream_overflow_bytes;
         size_t queue_full_failures;
+        size_t budget_drops;
+        size_t space_wakeups;
+        bool queue_blocked; //last push got FULL, frames / bytes wait for queue space
+        size_t space_slot; //waiter slot in the queue's space notifier, no_space_slot until the first FULL
         std::thread worker_thread;
+        sensor_task worker_task; //used instead of worker_thread when started on a sensor_executor
+
+        // a read larger than the stream buffer would only overwrite itself
+        size_t read_buffer_size() const {
+            size_t preferred = s_source.preferred_read_size();
+            return std::min(preferred != 0 ? preferred : DEFAULT_SOURCE_READ_BUFFER, st_buffer.get_capacity());
+        }
+
+        //in-flight payload accounting, the consumer releases after pop
+        bool reserve_payload(size_t bytes) {
+            if (budget == nullptr || budget->try_reserve(memory_category::IN_FLIGHT_PAYLOAD, bytes)) {
+                return true;
+            }
+            budget_drops++;
+            return false;
+        }
+
+        void release_payload(size_t bytes) {
+            if (budget != nullptr) {
+                budget->release(memory_category::IN_FLIGHT_PAYLOAD, bytes);
+            }
+        }
+
+        //counts the failure reasons, true when the measurement was enqueued
+        bool check_push_status(queue_status q_status) {
+            if (q_status == queue_status::FULL) {
+                queue_full_failures++;
+                queue_blocked = true;
+                return false;
+            }
+
+            if (q_status == queue_status::SHUTDOWN) {
+                eos_count++;
+                return false;
+            }
+
+            return true;
+        }
+
+        /*
+        After FULL: arm the queue space wakeup, then check the occupancy again
+        (the consumer may have drained the queue before the wakeup was armed).
+        Returns the fd to poll next to the source, -1 when there is space already,
+        no_space_wakeup when no waiter slot is left (resume on sensor bytes only).
+        The slot is taken on the first FULL, workers that never block (and coroutine workers) hold none.
+        */
+        int arm_space_wait() {
+            queue_space_notifier &notifier = global_q.space_notifier();
+            if (space_slot == no_space_slot) {
+                try {
+                    space_slot = notifier.register_waiter();
+                }
+                catch (const std::exception&) {
+                    return no_space_wakeup;
+                }
+            }
+            notifier.arm(space_slot);
+            size_t occupancy = global_q.size();
+            if (occupancy < global_q.capacity() && occupancy <= notifier.low_water_mark()) {
+                notifier.disarm(space_slot);
+                return -1;
+            }
+            return notifier.fd(space_slot);
+        }
 
         bool push_to_queue() {
+            if (aggregator != nullptr) {
+                return push_aggregated();
+            }
+
             //one measurement copy for every fun call, this is a compromise becuuse if we use move without copying,
             //we can have a movable (destroyed) object in the parser but the global queue will fail 
             measurement meas = f_parser.peek_frame();
             meas.sensor_id = this->sensor_id;
             meas.system_timestamp = std::chrono::steady_clock::now();
-            //here move can succeed but push may fail , very problematic if we dont have an obj copy
-            queue_status q_status = global_q.push(std::move(meas));
+            if (decoder != nullptr) {
+                decoder->decode_payload(meas, decode_scratch);
+            }
 
-            if (q_status == queue_status::FULL) {
-                queue_full_failures++;
-                return false;
+            //independent of the queue: a frame halted by FULL is published again (newer timestamp) on the retry
+            if (latest_values != nullptr) {
+                latest_values->update(sensor_id, meas);
             }
 
-            if (q_status == queue_status::SHUTDOWN) {
-                eos_count++;
+            //over the memory budget: drop this frame (counted) and keep parsing
+            size_t payload_bytes = meas.payload.size();
+            if (!reserve_payload(payload_bytes)) {
+                f_parser.pop_frame();
+                return true;
+            }
+
+            //here move can succeed but push may fail , very problematic if we dont have an obj copy
+            queue_status q_status;
+            {
+                PERF_SCOPE(push_perf, PUSH, sensor_id);
+                TRACE_BEGIN(push_span);
+                q_status = global_q.push(std::move(meas));
+                TRACE_END(push_span, PUSH, sensor_id, payload_bytes, q_status);
+            }
+            if (!check_push_status(q_status)) {
+                release_payload(payload_bytes);
                 return false;
             }
 
+            PERF_FRAMES(sensor_id, 1);
             f_parser.pop_frame();
             return true;
         }
 
+        /*
+        Aggregation path: every parser frame is consumed by the stage (no copy),
+        only the stage outputs are pushed. A pending output is retried before the next frame is fed,
+        so a FULL queue halts parsing exactly like the direct path.
+        */
+        bool push_aggregated() {
+            if (!aggregator->has_output()) {
+                measurement frame = f_parser.extract_frame();
+                frame.sensor_id = this->sensor_id;
+                frame.system_timestamp = std::chrono::steady_clock::now();
+                aggregator->feed(frame);
+                if (!aggregator->has_output()) {
+                    //frame absorbed by the stage
+                    return true;
+                }
+            }
+
+            //same copy compromise as the direct path, the output stays in the stage if push fails
+            measurement out = aggregator->peek_output();
+            if (decoder != nullptr) {
+                decoder->decode_payload(out, decode_scratch);
+            }
+
+            if (latest_values != nullptr) {
+                latest_values->update(sensor_id, out);
+            }
+
+            size_t payload_bytes = out.payload.size();
+            if (!reserve_payload(payload_bytes)) {
+                aggregator->pop_output();
+                return true;
+            }
+
+            queue_status q_status;
+            {
+                PERF_SCOPE(push_perf, PUSH, sensor_id);
+                TRACE_BEGIN(push_span);
+                q_status = global_q.push(std::move(out));
+                TRACE_END(push_span, PUSH, sensor_id, payload_bytes, q_status);
+            }
+            if (!check_push_status(q_status)) {
+                release_payload(payload_bytes);
+                return false;
+            }
+
+            PERF_FRAMES(sensor_id, 1);
+            aggregator->pop_output();
+            return true;
+        }
+
+        /*
+        Append newly read bytes to the stream buffer, then parse and publish as many frames as possible.
+        Shared by the thread (run) and coroutine (run_async) workers.
+        Returns false on an internal stream buffer error (worker must exit).
+        */
+        bool process_bytes(const uint8_t *data, size_t len) {
+            PERF_SCOPE(parse_perf, PARSE, sensor_id);
+            PERF_BYTES(sensor_id, len);
+            TRACE_BEGIN(process_span);
+            queue_blocked = false;
+            uint8_t chunk[PARSER_CHUNK_SIZE];
+            size_t s_buf_num_of_bytes = st_buffer.append(data, len);
+            if (s_buf_num_of_bytes < len) {
+                stream_overflow_bytes += len - s_buf_num_of_bytes;
+                //stream buffer capacity is to small for the amount of data from sensor
+                //lost oldest data do to stream buffer
+            }
+
+            //a stage output halted by FULL is retried first, the parser may have no frame left to trigger it
+            while (aggregator != nullptr && aggregator->has_output()) {
+                if (!push_aggregated()) {
+                    TRACE_END(process_span, PROCESS, sensor_id, len, 0);
+                    return true;
+                }
+            }
+
+            while (f_parser.has_frame()) {
+                if (!push_to_queue()) {
+                    break;
+                }
+            }
+
+            // Extraction from the stream buffer append to parser and to global queue:
+            while (st_buffer.available() > 0 && f_parser.has_capacity()) {
+                size_t min_extract = std::min(st_buffer.available() ,PARSER_CHUNK_SIZE);
+                
+                if (!st_buffer.extract(chunk, min_extract)) {
+                    //should no happened , maybe throw a exception
+                    return false;
+                }
+                f_parser.feed_bytes(chunk, min_extract);
+
+                //push to global queue
+                while (f_parser.has_frame()) {
+                    if (!push_to_queue()) {
+                        break;
+                    }                        
+                }
+            }
+            TRACE_END(process_span, PROCESS, sensor_id, len, 0);
+            return true;
+        }
+
         /*
         run() must exit when any of these happen:
         stop_req == true
@@ -76,16 +288,48 @@ class sensor_worker {
         When global queue is full, parsing halts.
         Stream buffer continues receiving and overwrites oldest bytes.
         Result: oldest raw sensor data may be lost under overload.
+        Parsing resumes on new bytes, or as soon as the consumer drained the queue to its low-water mark
+        (queue_space_notifier, polled next to the source fd), whichever comes first.
         */
         void run() {
-            uint8_t chunk[PARSER_CHUNK_SIZE];
-            std::vector<uint8_t> read_buffer(std::min(MAX_SOURCE_READ_BUFFER, st_buffer.get_capacity()));
+            std::vector<uint8_t> read_buffer(read_buffer_size());
             ssize_t num_of_bytes_from_sensor = 0;
-            size_t s_buf_num_of_bytes = 0;
        
             while (!stop_req.load()) {
 
-                num_of_bytes_from_sensor = s_source.read_bytes(read_buffer.data(), read_buffer.size());
+                int wake_fd = -1;
+                if (queue_blocked) {
+                    wake_fd = arm_space_wait();
+                    if (wake_fd == -1) {
+                        //space already available, resume without waiting for bytes
+                        if (!process_bytes(nullptr, 0)) {
+                            return;
+                        }
+                        continue;
+                    }
+                    if (wake_fd == no_space_wakeup) {
+                        wake_fd = -1;
+                    }
+                }
+
+                {
+                    PERF_SCOPE(read_perf, READ, sensor_id);
+                    TRACE_BEGIN(read_span);
+                    num_of_bytes_from_sensor = s_source.read_bytes_or_wake(read_buffer.data(), read_buffer.size(), wake_fd);
+                    TRACE_END(read_span, READ, sensor_id, num_of_bytes_from_sensor, 0);
+                }
+
+                if (wake_fd >= 0) {
+                    global_q.space_notifier().disarm(space_slot);
+                }
+
+                if (num_of_bytes_from_sensor == sensor_source::woken) {
+                    space_wakeups++;
+                    if (!process_bytes(nullptr, 0)) {
+                        return;
+                    }
+                    continue;
+                }
 
                 if (num_of_bytes_from_sensor == 0) {
                     eos_count++;
@@ -97,35 +341,8 @@ class sensor_worker {
                     continue;
                 }                
 
-                s_buf_num_of_bytes = st_buffer.append(read_buffer.data(), static_cast<size_t>(num_of_bytes_from_sensor));
-                if (s_buf_num_of_bytes < static_cast<size_t>(num_of_bytes_from_sensor)) {
-                    stream_overflow_bytes += static_cast<size_t>(num_of_bytes_from_sensor) - s_buf_num_of_bytes;
-                    //stream buffer capacity is to small for the amount of data from sensor
-                    //lost oldest data do to stream buffer
-                }
-
-                while (f_parser.has_frame()) {
-                    if (!push_to_queue()) {
-                        break;
-                    }
-                }
-
-                // Extraction from the stream buffer append to parser and to global queue:
-                while (st_buffer.available() > 0 && f_parser.has_capacity()) {
-                    size_t min_extract = std::min(st_buffer.available() ,PARSER_CHUNK_SIZE);
-                    
-                    if (!st_buffer.extract(chunk, min_extract)) {
-                        //should no happened , maybe throw a exception
-                        return;
-                    }
-                    f_parser.feed_bytes(chunk, min_extract);
-
-                    //push to global queue
-                    while (f_parser.has_frame()) {
-                        if (!push_to_queue()) {
-                            break;
-                        }                        
-                    }
+                if (!process_bytes(read_buffer.data(), static_cast<size_t>(num_of_bytes_from_sensor))) {
+                    return;
                 }
             } 
             //source: read_bytes() is blocking
@@ -136,13 +353,54 @@ class sensor_worker {
             //must exit run when stop is executed.
         }
 
+        /*
+        Coroutine version of run(), same exit conditions and backpressure policy
+        (without the queue space wakeup, parsing resumes on new bytes only).
+        Suspends (instead of blocking a thread) while the source has no data,
+        resumed by the executor loop when the source fd or its stop eventfd is readable.
+        */
+        sensor_task run_async(sensor_executor::loop &lp) {
+            std::vector<uint8_t> read_buffer(read_buffer_size());
+            sensor_executor::async_reader reader(lp, s_source);
+            ssize_t num_of_bytes_from_sensor = 0;
+
+            while (!stop_req.load()) {
+
+                num_of_bytes_from_sensor = co_await reader.read(std::span<uint8_t>(read_buffer));
+                //instant, not a span: other coroutines of this loop run while this one is suspended
+                TRACE_INSTANT(READ, sensor_id, num_of_bytes_from_sensor);
+
+                if (num_of_bytes_from_sensor == sensor_source::would_block) {
+                    //spurious wakeup
+                    continue;
+                }
+
+                if (num_of_bytes_from_sensor == 0) {
+                    eos_count++;
+                    break;
+                }
+
+                if (num_of_bytes_from_sensor < 0) {
+                    read_errors++;
+                    continue;
+                }
+
+                if (!process_bytes(read_buffer.data(), static_cast<size_t>(num_of_bytes_from_sensor))) {
+                    co_return;
+                }
+            }
+        }
+
 
     public:
-        sensor_worker(size_t stream_buffer_size, size_t sensorid, sensor_source &sen_s, frame_parser &f_prsr, global_queue<measurement> &g_q): st_buffer(std::max(stream_buffer_size, PARSER_CHUNK_SIZE)), sensor_id(sensorid), f_parser(f_prsr), global_q(g_q), s_source(sen_s), stop_req{false}, started{false}, read_errors(0), eos_count(0), stream_overflow_bytes(0), queue_full_failures(0) {
+        sensor_worker(size_t stream_buffer_size, size_t sensorid, sensor_source &sen_s, frame_parser &f_prsr, Queue &g_q, aggregation_stage *aggr = nullptr, const memory_policy &buffer_policy = {}, memory_budget *mem_budget = nullptr, latest_value_table *latest = nullptr, const sample_decoder *dec = nullptr): st_buffer(std::max(stream_buffer_size, PARSER_CHUNK_SIZE), buffer_policy), sensor_id(sensorid), f_parser(f_prsr), global_q(g_q), s_source(sen_s), aggregator(aggr), budget(mem_budget), latest_values(latest), decoder(dec), stop_req{false}, started{false}, read_errors(0), eos_count(0), stream_overflow_bytes(0), queue_full_failures(0), budget_drops(0), space_wakeups(0), queue_blocked(false), space_slot(no_space_slot) {
         }
 
         ~sensor_worker() {
             stop();
+            if (space_slot != no_space_slot) {
+                global_q.space_notifier().release_waiter(space_slot);
+            }
         }
 
         size_t get_sensor_id() const {
@@ -164,6 +422,25 @@ class sensor_worker {
             return true;
         }
 
+        // same rules as start(), but the worker runs as a coroutine on one of the executor loops
+        // the source must support non-blocking reads (sensor_source::pollable_fds())
+        bool start(sensor_executor &executor) {
+            if (started) {
+                return false;
+            }
+
+            if (s_source.pollable_fds().empty()) {
+                throw std::invalid_argument("sensor source does not support async reads");
+            }
+
+            started = true;
+            stop_req = false;
+            sensor_executor::loop &lp = executor.next_loop();
+            worker_task = run_async(lp);
+            lp.post(worker_task.handle());
+            return true;
+        }
+
         void stop() {
 
             //Set a stop_requested flag
@@ -176,6 +453,11 @@ class sensor_worker {
             if (worker_thread.joinable()) {
                 worker_thread.join();
             }
+            //Or wait for the coroutine to finish on its loop
+            if (worker_task.valid()) {
+                worker_task.wait();
+                worker_task.reset();
+            }
             started = false;
         }
         
@@ -186,4 +468,28 @@ class sensor_worker {
         size_t get_eos_count() {
             return eos_count;
         }  
+
+        size_t get_queue_full_failures() {
+            return queue_full_failures;
+        }
+
+        // frames dropped because the pipeline memory budget was exhausted
+        size_t get_budget_drops() {
+            return budget_drops;
+        }
+
+        // times parsing resumed because the queue had space again (not because of new bytes)
+        size_t get_space_wakeups() {
+            return space_wakeups;
+        }
+
+        // stream buffer + read buffer (parser scratch is reported by the parser)
+        size_t static_memory_bytes() const {
+            return st_buffer.get_capacity() + read_buffer_size();
+        }
+
+        // aggregation stage frames in per measurement out, 1.0 when the stage is disabled
+        double get_reduction_ratio() const {
+            return (aggregator != nullptr) ? aggregator->reduction_ratio() : 1.0;
+        }
 };
@@ -0,0 +1,201 @@
+#ifndef _SEQPACKET_SOURCE_H_
+#define _SEQPACKET_SOURCE_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+#include "unique_fd.h"
+#include "packet_source.h"
+
+/*
+    packet_source over an AF_UNIX SOCK_SEQPACKET connection (message boundaries are kept by the kernel).
+
+    Connects to a local device daemon listening on path, or takes an already connected socket
+    (accept() result, socketpair()).
+
+    read_packets(): poll(socket, stop eventfd), then one recvmmsg() receives up to batch datagrams
+    into a contiguous receive arena (one syscall per batch instead of one per packet), then each
+    datagram is copied into its packets[i].
+    Datagrams longer than max_packet_size are truncated by the kernel (MSG_TRUNC), they are dropped
+    and counted (get_truncated_count()).
+    The peer closing the connection is end of stream (returns 0). The kernel reports it as a zero
+    length datagram, so zero length datagrams cannot be used as payloads.
+
+    std::system_error when the socket / eventfd cannot be created or connected.
+*/
+
+struct seqpacket_config {
+    std::string path; //daemon socket path (ignored when a connected fd is given)
+    size_t max_packet_size = 2048; //bytes
+    size_t batch = 32; //datagrams per recvmmsg()
+};
+
+class seqpacket_source : public packet_source
+{
+private:
+    unique_fd s_fd;
+    unique_fd s_stopfd;
+    size_t max_packet;
+    size_t batch_size;
+    std::vector<uint8_t> arena;
+    std::vector<iovec> iovecs;
+    std::vector<mmsghdr> msgs;
+    size_t truncated;
+    bool peer_closed; //end of stream seen, packets before it were returned first
+
+    static size_t validated(size_t v, const char *what) {
+        if (v == 0) {
+            throw std::invalid_argument(what);
+        }
+        return v;
+    }
+
+    void init() {
+        int tmp_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (tmp_fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "eventfd failed ");
+        }
+        s_stopfd.reset(tmp_fd);
+
+        arena.resize(batch_size * max_packet);
+        iovecs.resize(batch_size);
+        msgs.resize(batch_size);
+        for (size_t i = 0; i < batch_size; i++) {
+            iovecs[i].iov_base = arena.data() + i * max_packet;
+            iovecs[i].iov_len = max_packet;
+            std::memset(&msgs[i], 0, sizeof(mmsghdr));
+            msgs[i].msg_hdr.msg_iov = &iovecs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+public:
+    // connects to conf.path
+    seqpacket_source(const seqpacket_config &conf) : max_packet(validated(conf.max_packet_size, "illegal packet size")), batch_size(validated(conf.batch, "illegal batch size")), truncated(0), peer_closed(false) {
+        sockaddr_un addr{};
+        if (conf.path.empty() || conf.path.size() >= sizeof(addr.sun_path)) {
+            throw std::invalid_argument("illegal socket path");
+        }
+
+        int tmp_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (tmp_fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "socket failed ");
+        }
+        s_fd.reset(tmp_fd);
+
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, conf.path.c_str(), conf.path.size());
+        if (connect(s_fd.get(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            throw std::system_error(errno, std::generic_category(), "connect failed ");
+        }
+        init();
+    }
+
+    // takes ownership of a connected SOCK_SEQPACKET socket, conf.path is ignored
+    seqpacket_source(unique_fd connected_fd, const seqpacket_config &conf) : s_fd(std::move(connected_fd)), max_packet(validated(conf.max_packet_size, "illegal packet size")), batch_size(validated(conf.batch, "illegal batch size")), truncated(0), peer_closed(false) {
+        init();
+    }
+
+    ssize_t read_packets(std::vector<uint8_t> *packets, std::chrono::steady_clock::time_point *timestamps, size_t max_packets) override {
+        unsigned int want = static_cast<unsigned int>(std::min(max_packets, batch_size));
+        if (want == 0) {
+            return -1;
+        }
+        if (peer_closed) {
+            return 0;
+        }
+
+        pollfd plfd[2]{};
+        plfd[0].fd = s_fd.get();
+        plfd[1].fd = s_stopfd.get();
+        plfd[0].events = POLLIN;
+        plfd[1].events = POLLIN;
+
+        while (true) {
+            int rc = poll(&plfd[0], 2, -1); //block until: datagram / peer closed / stop request
+
+            if (rc < 0) {
+                if (errno == EINTR) continue;
+                return -1;
+            }
+
+            //stop request
+            if (plfd[1].revents & POLLIN) {
+                uint64_t v;
+                read(s_stopfd.get(), &v, sizeof(v));
+                return 0;
+            }
+
+            if (plfd[0].revents & POLLIN) {
+                int n = recvmmsg(s_fd.get(), msgs.data(), want, MSG_DONTWAIT, nullptr);
+                if (n < 0) {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                        continue;
+                    }
+                    return -1;
+                }
+                if (n == 0) {
+                    return 0;
+                }
+
+                //AF_UNIX has no kernel receive timestamps, one clock read per batch
+                auto now = std::chrono::steady_clock::now();
+                size_t out = 0;
+                for (int i = 0; i < n; i++) {
+                    if (msgs[i].msg_len == 0) {
+                        peer_closed = true;
+                        break;
+                    }
+                    if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                        truncated++;
+                        continue;
+                    }
+                    const uint8_t *data = arena.data() + static_cast<size_t>(i) * max_packet;
+                    timestamps[out] = now;
+                    packets[out++].assign(data, data + msgs[i].msg_len);
+                }
+                if (out > 0 || peer_closed) {
+                    return static_cast<ssize_t>(out);
+                }
+                continue;
+            }
+
+            //peer closed the connection, nothing left to read
+            if (plfd[0].revents & POLLHUP) {
+                return 0;
+            }
+
+            if (plfd[0].revents & (POLLERR | POLLNVAL) || plfd[1].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                return -1;
+            }
+        }
+    }
+
+    int stop_request() override {
+        uint64_t one = 1;
+        if (write(s_stopfd.get(), &one, sizeof(one)) != sizeof(one)) {
+            return -1;
+        }
+        return 0;
+    }
+
+    size_t max_packet_size() const override { return max_packet; }
+    size_t max_batch() const override { return batch_size; }
+
+    // datagrams dropped because they did not fit in max_packet_size
+    size_t get_truncated_count() const { return truncated; }
+};
+
+#endif
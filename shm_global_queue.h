@@ -0,0 +1,527 @@
+#ifndef _SHM_GLOBAL_QUEUE_H_
+#define _SHM_GLOBAL_QUEUE_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <span>
+#include <new>
+#include <utility>
+#include <stdexcept>
+#include <system_error>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include "unique_fd.h"
+#include "measurement.h"
+#include "lockless_global_queue.h"
+
+/*
+    Cross process variant of lockless_global_queue (same seq based MPSC algorithm).
+
+    The queue lives in a memfd region that another process maps, so the consumer can run
+    in a separate process without sockets or serialization on the data path.
+
+    measurement holds a std::vector (heap pointer) that means nothing in another address space,
+    so slots are pointer-free and fixed size: metadata + up to max_payload inline bytes.
+
+    Process setup:
+        producer: auto q = shm_global_queue<64>::create(capacity);
+                  q.send_fds(unix_sock);           // memfd + wakeup eventfd over SCM_RIGHTS
+        consumer: auto q = shm_global_queue<64>::receive_fds(unix_sock);
+                  q.register_consumer();
+                  q.peek(view) ... q.release();    // zero-copy: view points into the shared slot
+
+    Wakeups: the consumer sets consumer_waiting before sleeping on the eventfd,
+    producers only write the eventfd when that flag is set (no syscall per push when busy).
+
+    Crash detection: every producer process registers in one of max_producers header slots, the consumer
+    in its own slot. A slot holds the pid and the process start time (/proc/<pid>/stat, field 22),
+    so a pid recycled by an unrelated process does not count as alive. producer_alive() is true while
+    any registered producer lives, consumer_alive() checks the consumer. Slots of dead producers are
+    reused by register_producer().
+
+    A producer that dies between claiming and publishing a slot would hold the consumer at that slot
+    while other producers keep going. Every claimed slot records its claimer (identity + the lap it was
+    claimed for), wait_for_data() skips a head slot whose claimer is dead (counted in abandoned_count())
+    and moves on to the next one. A producer killed in the few instructions between its claim and the
+    claim record is only caught once no producer is alive: wait_for_data() then reports SHUTDOWN.
+
+    Only std::atomic types that are lock free (and so address free) are placed in the region.
+*/
+
+template <size_t max_payload>
+class shm_global_queue
+{
+private:
+    static constexpr uint64_t header_magic = 0x53504d5351554555ULL; //"SPMSQUEU"
+    static constexpr uint32_t layout_version = 3;
+    static constexpr size_t max_producers = 16;
+    //process identity in one word: pid (PID_MAX_LIMIT is 2^22) | start time in clock ticks << pid_bits, 0 = free
+    static constexpr unsigned pid_bits = 22;
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory atomics must be lock free");
+    static_assert(std::atomic<int32_t>::is_always_lock_free, "shared memory atomics must be lock free");
+
+    struct header {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t payload_size;
+        uint64_t capacity;
+        alignas(64) std::atomic<uint64_t> read;
+        alignas(64) std::atomic<uint64_t> write;
+        alignas(64) std::atomic<uint32_t> shut_down;
+        std::atomic<uint32_t> consumer_waiting;
+        std::atomic<uint64_t> consumer;
+        std::atomic<uint64_t> producers[max_producers];
+    };
+
+    struct alignas(64) slot {
+        std::atomic<uint64_t> seq;
+        std::atomic<uint64_t> claim; //lap + 1 of the last claim, claimer is valid when it matches
+        uint64_t claimer;
+        int64_t timestamp_ns;
+        uint64_t sensor_id;
+        uint64_t sequence_number;
+        uint32_t payload_len;
+        uint8_t payload[max_payload];
+    };
+
+    unique_fd mem_fd;
+    unique_fd wake_fd;
+    void *region;
+    size_t region_size;
+    header *hdr;
+    slot *slots;
+    size_t mask;
+    uint64_t producer_id; //identity written into claimed slots, set by register_producer()
+    size_t abandoned;
+
+    static size_t region_bytes(size_t capacity) {
+        return sizeof(header) + capacity * sizeof(slot);
+    }
+
+    shm_global_queue(unique_fd m_fd, unique_fd w_fd, size_t size) : mem_fd(std::move(m_fd)), wake_fd(std::move(w_fd)), region(nullptr), region_size(size), hdr(nullptr), slots(nullptr), mask(0), producer_id(0), abandoned(0) {
+        void *p = mmap(nullptr, region_size, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd.get(), 0);
+        if (p == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap failed ");
+        }
+        region = p;
+        hdr = static_cast<header*>(region);
+        slots = reinterpret_cast<slot*>(static_cast<uint8_t*>(region) + sizeof(header));
+    }
+
+    // starttime of /proc/<pid>/stat, 0 when the process does not exist (or /proc is not readable)
+    static uint64_t start_time(pid_t pid) {
+        char path[32];
+        std::snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+        FILE *f = std::fopen(path, "r");
+        if (f == nullptr) {
+            return 0;
+        }
+        char line[1024];
+        size_t n = std::fread(line, 1, sizeof(line) - 1, f);
+        std::fclose(f);
+        line[n] = '\0';
+
+        //comm (field 2) may contain spaces and ')', fields 3.. start after the last ')'
+        const char *p = std::strrchr(line, ')');
+        if (p == nullptr) {
+            return 0;
+        }
+        for (int field = 2; field < 22 && p != nullptr; field++) {
+            p = std::strchr(p + 1, ' ');
+        }
+        return (p != nullptr) ? std::strtoull(p + 1, nullptr, 10) : 0;
+    }
+
+    static uint64_t identity(pid_t pid) {
+        return (start_time(pid) << pid_bits) | static_cast<uint64_t>(pid);
+    }
+
+    // not cached: a forked child must not register as its parent
+    static uint64_t self_identity() {
+        return identity(getpid());
+    }
+
+    static bool process_alive(uint64_t id) {
+        if (id == 0) {
+            return false;
+        }
+        pid_t pid = static_cast<pid_t>(id & ((uint64_t{1} << pid_bits) - 1));
+        uint64_t started = id >> pid_bits;
+        if (started == 0) {
+            //start time was not readable at registration, only the pid can be probed
+            return kill(pid, 0) == 0 || errno == EPERM;
+        }
+        return start_time(pid) == started;
+    }
+
+    void wake_consumer() {
+        if (hdr->consumer_waiting.load(std::memory_order_seq_cst) != 0) {
+            uint64_t v = 1;
+            write(wake_fd.get(), &v, sizeof(v));
+        }
+    }
+
+public:
+    // capacity must be a power of 2
+    static shm_global_queue create(size_t capacity) {
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("illegal capacity value");
+        }
+
+        int tmp_fd = memfd_create("sensor_pipeline_queue", MFD_CLOEXEC);
+        if (tmp_fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "memfd_create failed ");
+        }
+        unique_fd m_fd(tmp_fd);
+
+        size_t size = region_bytes(capacity);
+        if (ftruncate(m_fd.get(), static_cast<off_t>(size)) != 0) {
+            throw std::system_error(errno, std::generic_category(), "ftruncate failed ");
+        }
+
+        tmp_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (tmp_fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "eventfd failed ");
+        }
+        unique_fd w_fd(tmp_fd);
+
+        shm_global_queue q(std::move(m_fd), std::move(w_fd), size);
+
+        //memfd pages start zeroed, construct the atomics in place
+        header *h = new (q.region) header{};
+        h->magic = header_magic;
+        h->version = layout_version;
+        h->payload_size = max_payload;
+        h->capacity = capacity;
+        h->producers[0].store(self_identity(), std::memory_order_relaxed);
+        for (size_t i = 0; i < capacity; i++) {
+            slot *s = new (&q.slots[i]) slot;
+            s->seq.store(i, std::memory_order_relaxed);
+        }
+        q.mask = capacity - 1;
+        q.producer_id = h->producers[0].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return q;
+    }
+
+    // maps a region created by another process, validates its layout
+    static shm_global_queue attach(unique_fd m_fd, unique_fd w_fd) {
+        off_t size = lseek(m_fd.get(), 0, SEEK_END);
+        if (size < static_cast<off_t>(sizeof(header))) {
+            throw std::runtime_error("shared queue region too small");
+        }
+
+        shm_global_queue q(std::move(m_fd), std::move(w_fd), static_cast<size_t>(size));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (q.hdr->magic != header_magic || q.hdr->version != layout_version || q.hdr->payload_size != max_payload) {
+            throw std::runtime_error("shared queue layout mismatch");
+        }
+        //capacity comes from the other process, it is checked before mask and slots depend on it
+        uint64_t cap = q.hdr->capacity;
+        if (cap == 0 || (cap & (cap - 1)) != 0) {
+            throw std::runtime_error("shared queue layout mismatch");
+        }
+        if (cap > (q.region_size - sizeof(header)) / sizeof(slot)) {
+            throw std::runtime_error("shared queue region too small");
+        }
+        q.mask = q.hdr->capacity - 1;
+        return q;
+    }
+
+    shm_global_queue(const shm_global_queue&) = delete;
+    shm_global_queue& operator=(const shm_global_queue&) = delete;
+
+    shm_global_queue(shm_global_queue &&rhs) noexcept : mem_fd(std::move(rhs.mem_fd)), wake_fd(std::move(rhs.wake_fd)), region(std::exchange(rhs.region, nullptr)), region_size(rhs.region_size), hdr(std::exchange(rhs.hdr, nullptr)), slots(std::exchange(rhs.slots, nullptr)), mask(rhs.mask), producer_id(rhs.producer_id), abandoned(rhs.abandoned) {
+    }
+
+    shm_global_queue& operator=(shm_global_queue &&) = delete;
+
+    ~shm_global_queue() {
+        if (region != nullptr) {
+            munmap(region, region_size);
+        }
+    }
+
+    size_t capacity() const { return hdr->capacity; }
+
+    // head slots skipped by wait_for_data() because their claimer died before publishing
+    size_t abandoned_count() const { return abandoned; }
+
+    // sends the memfd and the wakeup eventfd over a connected AF_UNIX socket
+    void send_fds(int unix_sock) const {
+        int fds[2] = {mem_fd.get(), wake_fd.get()};
+        char tag = 'q';
+        iovec iov{&tag, sizeof(tag)};
+        alignas(cmsghdr) char ctrl[CMSG_SPACE(sizeof(fds))]{};
+
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = ctrl;
+        msg.msg_controllen = sizeof(ctrl);
+
+        cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+        std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+        ssize_t ret;
+        do {
+            ret = sendmsg(unix_sock, &msg, MSG_NOSIGNAL);
+        } while (ret < 0 && errno == EINTR);
+        if (ret < 0) {
+            throw std::system_error(errno, std::generic_category(), "sendmsg failed ");
+        }
+    }
+
+    static shm_global_queue receive_fds(int unix_sock) {
+        int fds[2] = {-1, -1};
+        char tag = 0;
+        iovec iov{&tag, sizeof(tag)};
+        alignas(cmsghdr) char ctrl[CMSG_SPACE(sizeof(fds))]{};
+
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = ctrl;
+        msg.msg_controllen = sizeof(ctrl);
+
+        ssize_t ret;
+        do {
+            ret = recvmsg(unix_sock, &msg, MSG_CMSG_CLOEXEC);
+        } while (ret < 0 && errno == EINTR);
+        if (ret < 0) {
+            throw std::system_error(errno, std::generic_category(), "recvmsg failed ");
+        }
+
+        cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        if (ret == 0 || cmsg == nullptr || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+            throw std::runtime_error("no shared queue fds received");
+        }
+        std::memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+        return attach(unique_fd(fds[0]), unique_fd(fds[1]));
+    }
+
+    /*
+        Takes a producer slot for this process (no-op when it has one), a free slot or the slot of a dead producer.
+        Throws std::runtime_error when max_producers live processes are registered.
+        A forked child calls it before its first push, push() registers lazily otherwise.
+    */
+    void register_producer() {
+        uint64_t self = self_identity();
+        for (auto &p : hdr->producers) {
+            if (p.load(std::memory_order_acquire) == self) {
+                producer_id = self;
+                return;
+            }
+        }
+        for (auto &p : hdr->producers) {
+            uint64_t id = p.load(std::memory_order_acquire);
+            while (!process_alive(id)) {
+                if (p.compare_exchange_weak(id, self, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    producer_id = self;
+                    return;
+                }
+            }
+        }
+        throw std::runtime_error("too many shared queue producers");
+    }
+
+    // clean producer exit, frees the slot of this process
+    void unregister_producer() {
+        uint64_t self = self_identity();
+        for (auto &p : hdr->producers) {
+            uint64_t id = self;
+            p.compare_exchange_strong(id, 0, std::memory_order_acq_rel);
+        }
+        producer_id = 0;
+    }
+
+    void register_consumer() { hdr->consumer.store(self_identity(), std::memory_order_release); }
+
+    bool producer_alive() const {
+        for (auto &p : hdr->producers) {
+            if (process_alive(p.load(std::memory_order_acquire))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool consumer_alive() const { return process_alive(hdr->consumer.load(std::memory_order_acquire)); }
+
+    //producer side, payload larger than max_payload is a configuration error (throws)
+    queue_status push(const measurement &m) {
+        if (m.payload.size() > max_payload) {
+            throw std::length_error("payload larger than shared queue slot");
+        }
+        if (producer_id == 0) {
+            register_producer();
+        }
+
+        uint64_t p{};
+        int64_t  diff = 0;
+        slot *s = nullptr;
+
+        while (true) {
+            if (hdr->shut_down.load(std::memory_order_relaxed) != 0) {
+                return queue_status::SHUTDOWN;
+            }
+
+            p = hdr->write.load(std::memory_order_relaxed);
+            s = &slots[p & mask];
+
+            diff = (int64_t)s->seq.load(std::memory_order_acquire) - (int64_t)p;
+            if (diff == 0) {
+                if (hdr->write.compare_exchange_weak(p, p + 1, std::memory_order_relaxed, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if(diff < 0) {
+                return queue_status::FULL;
+            }
+        }
+
+        //claim record first: if this process dies from here on, the consumer can tell and skip the slot
+        s->claimer = producer_id;
+        s->claim.store(p + 1, std::memory_order_release);
+
+        s->timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(m.system_timestamp.time_since_epoch()).count();
+        s->sensor_id = m.sensor_id;
+        s->sequence_number = m.sequence_number;
+        s->payload_len = static_cast<uint32_t>(m.payload.size());
+        std::memcpy(s->payload, m.payload.data(), m.payload.size());
+        s->seq.store(p + 1, std::memory_order_seq_cst);
+
+        wake_consumer();
+        return queue_status::OK;
+    }
+
+    // points into the shared slot, valid until release()
+    struct view {
+        std::chrono::steady_clock::time_point system_timestamp;
+        size_t sensor_id;
+        size_t sequence_number;
+        std::span<const uint8_t> payload;
+    };
+
+    /*
+        Consumer side (single consumer), zero-copy:
+        peek() exposes the oldest published slot, release() hands it back to producers.
+        steady_clock is system wide on Linux (CLOCK_MONOTONIC), so timestamps compare across processes.
+    */
+    queue_status peek(view &v) {
+        if (hdr->shut_down.load(std::memory_order_relaxed) != 0) {
+            return queue_status::SHUTDOWN;
+        }
+
+        uint64_t p = hdr->read.load(std::memory_order_relaxed);
+        slot *s = &slots[p & mask];
+        if (s->seq.load(std::memory_order_acquire) != p + 1) {
+            return queue_status::EMPTY;
+        }
+
+        v.system_timestamp = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(s->timestamp_ns));
+        v.sensor_id = s->sensor_id;
+        v.sequence_number = s->sequence_number;
+        v.payload = std::span<const uint8_t>(s->payload, s->payload_len);
+        return queue_status::OK;
+    }
+
+    void release() {
+        uint64_t p = hdr->read.load(std::memory_order_relaxed);
+        hdr->read.store(p + 1, std::memory_order_relaxed);
+        slots[p & mask].seq.store(p + hdr->capacity, std::memory_order_release);
+    }
+
+    //copying pop, same contract as global_queue::pop
+    queue_status pop(measurement &meas) {
+        view v;
+        queue_status q_status = peek(v);
+        if (q_status != queue_status::OK) {
+            return q_status;
+        }
+        meas.payload.assign(v.payload.begin(), v.payload.end());
+        meas.system_timestamp = v.system_timestamp;
+        meas.sensor_id = v.sensor_id;
+        meas.sequence_number = v.sequence_number;
+        release();
+        return queue_status::OK;
+    }
+
+    /*
+        Consumer side: sleeps on the wakeup eventfd until a slot is published or timeout.
+        Returns OK (data ready), EMPTY (timeout), SHUTDOWN (shutdown requested or producer process died).
+    */
+    queue_status wait_for_data(std::chrono::milliseconds timeout) {
+        view v;
+        queue_status q_status = peek(v);
+        if (q_status != queue_status::EMPTY) {
+            return q_status;
+        }
+
+        hdr->consumer_waiting.store(1, std::memory_order_seq_cst);
+        //re-check after publishing the flag: a producer that published before it saw 0 and did not write the eventfd
+        q_status = peek(v);
+        if (q_status == queue_status::EMPTY) {
+            pollfd plfd{wake_fd.get(), POLLIN, 0};
+            int rc = poll(&plfd, 1, static_cast<int>(timeout.count()));
+            if (rc > 0) {
+                uint64_t cnt;
+                read(wake_fd.get(), &cnt, sizeof(cnt));
+            }
+            q_status = peek(v);
+        }
+        hdr->consumer_waiting.store(0, std::memory_order_relaxed);
+
+        if (q_status == queue_status::EMPTY && skip_abandoned()) {
+            while (skip_abandoned()) {
+            }
+            q_status = peek(v);
+        }
+        if (q_status == queue_status::EMPTY && !producer_alive()) {
+            return queue_status::SHUTDOWN;
+        }
+        return q_status;
+    }
+
+    /*
+        Consumer side: releases the head slot when it is claimed but not published and its claimer is dead.
+        Returns true when a slot was skipped.
+    */
+    bool skip_abandoned() {
+        uint64_t p = hdr->read.load(std::memory_order_relaxed);
+        slot *s = &slots[p & mask];
+        //seq == p: free for this lap or claimed and not published yet, the claim record tells which
+        if (s->seq.load(std::memory_order_acquire) != p || s->claim.load(std::memory_order_acquire) != p + 1) {
+            return false;
+        }
+        if (process_alive(s->claimer)) {
+            return false;
+        }
+        abandoned++;
+        hdr->read.store(p + 1, std::memory_order_relaxed);
+        s->seq.store(p + hdr->capacity, std::memory_order_release);
+        return true;
+    }
+
+    void shutdown() {
+        hdr->shut_down.store(1, std::memory_order_release);
+        uint64_t v = 1;
+        write(wake_fd.get(), &v, sizeof(v));
+    }
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef _SLIP_FRAME_PARSER_H_
+#define _SLIP_FRAME_PARSER_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include "delimited_frame_parser.h"
+
+/*
+    SLIP (RFC 1055) framing:
+    END (0xC0) terminates a frame, inside a frame END is sent as ESC ESC_END and ESC as ESC ESC_ESC.
+
+    Unstuffing searches the next ESC with memchr and moves the literal run before it in one memmove,
+    payloads without escapes cost a single scan.
+*/
+
+class slip_frame_parser : public delimited_frame_parser
+{
+private:
+    static constexpr uint8_t end_byte = 0xC0;
+    static constexpr uint8_t esc = 0xDB;
+    static constexpr uint8_t esc_end = 0xDC;
+    static constexpr uint8_t esc_esc = 0xDD;
+
+    static size_t max_encoded_size(const delimited_parser_config &config) {
+        return 2 * (config.max_payload_len + (config.trailing_crc ? 1 : 0));
+    }
+
+protected:
+    bool decode(std::vector<uint8_t> &buf) override {
+        size_t n = buf.size();
+        uint8_t *data = buf.data();
+
+        const uint8_t *first_esc = static_cast<const uint8_t*>(std::memchr(data, esc, n));
+        if (first_esc == nullptr) {
+            //common case: nothing to unstuff
+            return true;
+        }
+
+        size_t r = static_cast<size_t>(first_esc - data);
+        size_t w = r;
+
+        while (r < n) {
+            //data[r] is ESC
+            if (r + 1 == n) {
+                return false;
+            }
+
+            uint8_t code = data[r + 1];
+            if (code == esc_end) {
+                data[w++] = end_byte;
+            }
+            else if (code == esc_esc) {
+                data[w++] = esc;
+            }
+            else {
+                return false;
+            }
+            r += 2;
+
+            const uint8_t *next = static_cast<const uint8_t*>(std::memchr(data + r, esc, n - r));
+            size_t run = (next == nullptr) ? n - r : static_cast<size_t>(next - (data + r));
+            std::memmove(data + w, data + r, run);
+            w += run;
+            r += run;
+        }
+
+        buf.resize(w);
+        return true;
+    }
+
+public:
+    slip_frame_parser(const delimited_parser_config &config = {}) : delimited_frame_parser(end_byte, max_encoded_size(config), config) {
+    }
+};
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef _SPSC_RING_H_
+#define _SPSC_RING_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+
+/*
+    Bounded single producer / single consumer ring, wait free on both sides.
+
+    - items are moved in and out (a measurement keeps its payload buffer, no copy)
+    - each side keeps a cached copy of the other side's index and reloads it only when the
+      ring looks full / empty, so the shared cache lines are touched once per batch, not per item
+    - push_batch() / pop_batch() publish a whole batch with one release store
+    - close() is called by the producer after its last push, the consumer sees closed() && empty
+
+    capacity is rounded up to a power of 2.
+*/
+
+template <typename T>
+class spsc_ring
+{
+private:
+    size_t cap;
+    size_t mask;
+    std::unique_ptr<T[]> slots;
+
+    alignas(64) std::atomic<size_t> head; //next write, owned by the producer
+    size_t cached_tail;
+    alignas(64) std::atomic<size_t> tail; //next read, owned by the consumer
+    size_t cached_head;
+    alignas(64) std::atomic<bool> closed_flag;
+
+    static size_t round_up(size_t n) {
+        if (n < 2) {
+            throw std::invalid_argument("illegal ring capacity");
+        }
+        size_t c = 1;
+        while (c < n) {
+            c <<= 1;
+        }
+        return c;
+    }
+
+    // producer side, number of free slots (the cached tail is refreshed only when it shows less than wanted)
+    size_t free_slots(size_t h, size_t wanted) {
+        if (cap - (h - cached_tail) < wanted) {
+            cached_tail = tail.load(std::memory_order_acquire);
+        }
+        return cap - (h - cached_tail);
+    }
+
+    // consumer side, number of readable slots
+    size_t ready_slots(size_t t, size_t wanted) {
+        if (cached_head - t < wanted) {
+            cached_head = head.load(std::memory_order_acquire);
+        }
+        return cached_head - t;
+    }
+
+public:
+    spsc_ring(size_t capacity) : cap(round_up(capacity)), mask(cap - 1), slots(new T[cap]), head(0), cached_tail(0), tail(0), cached_head(0), closed_flag(false) {}
+
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring& operator=(const spsc_ring&) = delete;
+
+    bool try_push(T &&item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (free_slots(h, 1) == 0) {
+            return false;
+        }
+        slots[h & mask] = std::move(item);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // moves up to n items from items[], returns how many were moved
+    size_t push_batch(T *items, size_t n) {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t count = std::min(n, free_slots(h, n));
+        for (size_t i = 0; i < count; i++) {
+            slots[(h + i) & mask] = std::move(items[i]);
+        }
+        if (count > 0) {
+            head.store(h + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    bool try_pop(T &out) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (ready_slots(t, 1) == 0) {
+            return false;
+        }
+        out = std::move(slots[t & mask]);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // moves up to max_items into out[], returns how many were moved
+    size_t pop_batch(T *out, size_t max_items) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t count = std::min(max_items, ready_slots(t, max_items));
+        for (size_t i = 0; i < count; i++) {
+            out[i] = std::move(slots[(t + i) & mask]);
+        }
+        if (count > 0) {
+            tail.store(t + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    // producer: no more pushes
+    void close() {
+        closed_flag.store(true, std::memory_order_release);
+    }
+
+    // consumer: closed and everything pushed before close() was popped
+    bool drained() {
+        if (!closed_flag.load(std::memory_order_acquire)) {
+            return false;
+        }
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed);
+    }
+
+    bool closed() const { return closed_flag.load(std::memory_order_acquire); }
+
+    size_t capacity() const { return cap; }
+
+    // approximate (racy) fill level, for metrics only
+    size_t size() const {
+        size_t t = tail.load(std::memory_order_relaxed);
+        return head.load(std::memory_order_relaxed) - t;
+    }
+};
+
+#endif
@@ -0,0 +1,377 @@
+#ifndef _STAGE_GRAPH_H_
+#define _STAGE_GRAPH_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+#include <span>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+#include <pthread.h>
+#include <sched.h>
+#include "measurement.h"
+#include "queue_concept.h"
+#include "memory_budget.h"
+#include "spsc_ring.h"
+#include "cpu_relax.h"
+#include "tracer.h"
+#include "perf_counters.h"
+
+/*
+    Consumer side processing pipeline behind the global queue.
+
+        global_queue -> [segment 0: stage, stage] -> spsc_ring -> [segment 1: stage] -> spsc_ring -> [segment 2: sink]
+
+    Stages (in the order they are added):
+        filter    : bool(const measurement&), false drops the measurement
+        transform : void(measurement&), in place (decode / convert / enrich)
+        sink      : void(std::span<measurement>), gets whole batches (write-out), must be the last stage
+
+    stage_options::own_thread starts a new segment (thread) at that stage, optionally pinned to a cpu.
+    Stages without it run inline on the previous stage's thread, so cheap stages do not pay a hop.
+    Segments are linked by wait-free SPSC rings, measurements are moved in batches (no payload copy).
+
+    Backpressure: a segment whose output ring is full stops reading its input, the stall propagates
+    back to segment 0, which stops popping the global queue, and then the workers see FULL
+    (parsing halts, same policy as without the graph).
+
+    Shutdown: after the global queue is shut down (sensor_manager::stop_all()) join() lets every segment
+    drain its input and close its output in order. stop() exits right away and discards what is in flight.
+
+    Metrics per stage: items in / out, busy time (wall time inside the stage function), the worst per item
+    time of a batch, throughput since start().
+*/
+
+enum class stage_kind {
+    FILTER,
+    TRANSFORM,
+    SINK
+};
+
+struct stage_options {
+    bool own_thread = false; //start a new thread at this stage (the first stage always gets one)
+    int cpu = -1; //pin that thread, -1 => not pinned
+    size_t link_capacity = 1024; //SPSC ring in front of this stage, own_thread only
+};
+
+struct stage_metrics {
+    std::string name;
+    stage_kind kind;
+    size_t items_in;
+    size_t items_out;
+    double busy_us;
+    double max_item_us; //worst batch time / batch items
+    double throughput; //items_in per second since start()
+};
+
+template <measurement_queue Queue>
+class stage_graph
+{
+private:
+    static constexpr size_t spins_before_sleep = 64;
+    static constexpr std::chrono::microseconds idle_sleep{50};
+
+    struct stage {
+        std::string name;
+        stage_kind kind;
+        std::function<bool(const measurement&)> filter_fn;
+        std::function<void(measurement&)> transform_fn;
+        std::function<void(std::span<measurement>)> sink_fn;
+        std::atomic<size_t> items_in{0};
+        std::atomic<size_t> items_out{0};
+        std::atomic<uint64_t> busy_ns{0};
+        std::atomic<uint64_t> max_item_ns{0};
+    };
+
+    struct segment {
+        size_t first_stage;
+        size_t end_stage;
+        int cpu;
+        std::unique_ptr<spsc_ring<measurement>> input; //nullptr => reads the global queue
+        spsc_ring<measurement> *output = nullptr;
+        std::thread seg_thread;
+        std::atomic<size_t> idle_polls{0};
+        std::atomic<size_t> backpressure_waits{0};
+    };
+
+    Queue &global_q;
+    memory_budget *budget; //optional, payload bytes are released after pop
+    size_t batch_items;
+    std::vector<std::unique_ptr<stage>> stages;
+    std::vector<std::unique_ptr<segment>> segments;
+    std::atomic<bool> stop_req;
+    bool started;
+    std::chrono::steady_clock::time_point start_time;
+
+    stage& add_stage(const std::string &name, stage_kind kind, const stage_options &opts) {
+        if (started) {
+            throw std::logic_error("stage_graph already started");
+        }
+        if (!stages.empty() && stages.back()->kind == stage_kind::SINK) {
+            throw std::logic_error("a sink must be the last stage");
+        }
+
+        if (segments.empty() || opts.own_thread) {
+            auto seg = std::make_unique<segment>();
+            seg->first_stage = stages.size();
+            seg->end_stage = stages.size();
+            seg->cpu = opts.cpu;
+            if (!segments.empty()) {
+                seg->input = std::make_unique<spsc_ring<measurement>>(opts.link_capacity);
+                segments.back()->output = seg->input.get();
+            }
+            segments.push_back(std::move(seg));
+        }
+
+        auto st = std::make_unique<stage>();
+        st->name = name;
+        st->kind = kind;
+        stages.push_back(std::move(st));
+        segments.back()->end_stage = stages.size();
+        return *stages.back();
+    }
+
+    // pops up to batch_items into batch, 0 when nothing is available. finished is set when the input ended.
+    size_t fill_batch(segment &seg, std::vector<measurement> &batch, bool &finished) {
+        PERF_SCOPE(pop_perf, POP, perf_profiler::consumer);
+        if (seg.input) {
+            size_t n = seg.input->pop_batch(batch.data(), batch_items);
+            if (n == 0 && seg.input->drained()) {
+                finished = true;
+            }
+            return n;
+        }
+
+        size_t n = 0;
+        while (n < batch_items) {
+            queue_status q_status = global_q.pop(batch[n]);
+            if (q_status == queue_status::SHUTDOWN) {
+                finished = (n == 0);
+                break;
+            }
+            if (q_status != queue_status::OK) {
+                break;
+            }
+            TRACE_INSTANT(POP, batch[n].sensor_id, batch[n].payload.size());
+            PERF_FRAMES(perf_profiler::consumer, 1);
+            PERF_BYTES(perf_profiler::consumer, batch[n].payload.size());
+            if (budget != nullptr) {
+                budget->release(memory_category::IN_FLIGHT_PAYLOAD, batch[n].payload.size());
+            }
+            n++;
+        }
+        return n;
+    }
+
+    // runs the segment stages over batch[0..n), returns the number of survivors (kept at the front)
+    size_t run_stages(segment &seg, std::vector<measurement> &batch, size_t n) {
+        PERF_SCOPE(consume_perf, CONSUME, perf_profiler::consumer);
+        for (size_t s = seg.first_stage; s < seg.end_stage && n > 0; s++) {
+            stage &st = *stages[s];
+            auto t0 = std::chrono::steady_clock::now();
+            size_t out = n;
+
+            switch (st.kind)
+            {
+            case stage_kind::FILTER:
+                out = 0;
+                for (size_t i = 0; i < n; i++) {
+                    if (st.filter_fn(batch[i])) {
+                        if (out != i) {
+                            batch[out] = std::move(batch[i]);
+                        }
+                        out++;
+                    }
+                }
+                break;
+            case stage_kind::TRANSFORM:
+                for (size_t i = 0; i < n; i++) {
+                    st.transform_fn(batch[i]);
+                }
+                break;
+            case stage_kind::SINK:
+                st.sink_fn(std::span<measurement>(batch.data(), n));
+                out = 0;
+                break;
+            }
+
+            uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count());
+            st.items_in.fetch_add(n, std::memory_order_relaxed);
+            st.items_out.fetch_add(out, std::memory_order_relaxed);
+            st.busy_ns.fetch_add(ns, std::memory_order_relaxed);
+            if (ns / n > st.max_item_ns.load(std::memory_order_relaxed)) {
+                st.max_item_ns.store(ns / n, std::memory_order_relaxed);
+            }
+            n = out;
+        }
+        return n;
+    }
+
+    // false when stop() was requested while the output was full
+    bool forward(segment &seg, std::vector<measurement> &batch, size_t n) {
+        size_t pushed = 0;
+        size_t spins = 0;
+        while (pushed < n) {
+            size_t k = seg.output->push_batch(batch.data() + pushed, n - pushed);
+            pushed += k;
+            if (k > 0) {
+                continue;
+            }
+            if (stop_req.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            seg.backpressure_waits.fetch_add(1, std::memory_order_relaxed);
+            if (spins++ < spins_before_sleep) {
+                cpu_relax();
+            }
+            else {
+                std::this_thread::sleep_for(idle_sleep);
+            }
+        }
+        return true;
+    }
+
+    void run_segment(segment &seg) {
+        std::vector<measurement> batch(batch_items);
+        size_t idle_rounds = 0;
+
+        while (!stop_req.load(std::memory_order_relaxed)) {
+            bool finished = false;
+            size_t n = fill_batch(seg, batch, finished);
+            if (finished) {
+                break;
+            }
+            if (n == 0) {
+                seg.idle_polls.fetch_add(1, std::memory_order_relaxed);
+                if (idle_rounds++ < spins_before_sleep) {
+                    std::this_thread::yield();
+                }
+                else {
+                    std::this_thread::sleep_for(idle_sleep);
+                }
+                continue;
+            }
+            idle_rounds = 0;
+
+            n = run_stages(seg, batch, n);
+            if (seg.output != nullptr && n > 0 && !forward(seg, batch, n)) {
+                break;
+            }
+        }
+
+        if (seg.output != nullptr) {
+            seg.output->close();
+        }
+    }
+
+    void join_all() {
+        for (auto &seg : segments) {
+            if (seg->seg_thread.joinable()) {
+                seg->seg_thread.join();
+            }
+        }
+    }
+
+public:
+    // batch_items: max measurements moved per pop / ring transfer, must be larger then 0
+    stage_graph(Queue &g_q, size_t batch_size = 32, memory_budget *mem_budget = nullptr) : global_q(g_q), budget(mem_budget), batch_items(batch_size), stop_req(false), started(false) {
+        if (batch_size == 0) {
+            throw std::invalid_argument("illegal batch size");
+        }
+    }
+
+    ~stage_graph() {
+        stop();
+    }
+
+    stage_graph(const stage_graph&) = delete;
+    stage_graph& operator=(const stage_graph&) = delete;
+
+    stage_graph& add_filter(const std::string &name, std::function<bool(const measurement&)> fn, const stage_options &opts = {}) {
+        add_stage(name, stage_kind::FILTER, opts).filter_fn = std::move(fn);
+        return *this;
+    }
+
+    stage_graph& add_transform(const std::string &name, std::function<void(measurement&)> fn, const stage_options &opts = {}) {
+        add_stage(name, stage_kind::TRANSFORM, opts).transform_fn = std::move(fn);
+        return *this;
+    }
+
+    stage_graph& add_sink(const std::string &name, std::function<void(std::span<measurement>)> fn, const stage_options &opts = {}) {
+        add_stage(name, stage_kind::SINK, opts).sink_fn = std::move(fn);
+        return *this;
+    }
+
+    // throws std::system_error if a thread cannot be pinned (the graph is stopped again)
+    void start() {
+        if (started) {
+            return;
+        }
+        if (stages.empty()) {
+            throw std::logic_error("stage_graph has no stages");
+        }
+        started = true;
+        start_time = std::chrono::steady_clock::now();
+
+        for (auto &seg : segments) {
+            segment *s = seg.get();
+            s->seg_thread = std::thread([this, s] { run_segment(*s); });
+            if (s->cpu >= 0) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(s->cpu, &set);
+                int err = pthread_setaffinity_np(s->seg_thread.native_handle(), sizeof(set), &set);
+                if (err != 0) {
+                    stop();
+                    throw std::system_error(err, std::generic_category(), "pthread_setaffinity_np failed ");
+                }
+            }
+        }
+    }
+
+    // waits until every segment has drained, returns only after the global queue was shut down
+    void join() {
+        join_all();
+    }
+
+    void stop() {
+        stop_req.store(true);
+        join_all();
+    }
+
+    std::vector<stage_metrics> metrics() const {
+        double elapsed_s = started ? std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count() : 0.0;
+        std::vector<stage_metrics> out;
+        out.reserve(stages.size());
+        for (const auto &st : stages) {
+            size_t in = st->items_in.load(std::memory_order_relaxed);
+            out.push_back(stage_metrics{
+                st->name,
+                st->kind,
+                in,
+                st->items_out.load(std::memory_order_relaxed),
+                st->busy_ns.load(std::memory_order_relaxed) / 1000.0,
+                st->max_item_ns.load(std::memory_order_relaxed) / 1000.0,
+                (elapsed_s > 0.0) ? static_cast<double>(in) / elapsed_s : 0.0
+            });
+        }
+        return out;
+    }
+
+    size_t segment_count() const { return segments.size(); }
+
+    // polls of segment i that found its input empty
+    size_t idle_polls(size_t i) const { return segments.at(i)->idle_polls.load(std::memory_order_relaxed); }
+
+    // times segment i waited for space in its output ring (downstream slower than upstream)
+    size_t backpressure_waits(size_t i) const { return segments.at(i)->backpressure_waits.load(std::memory_order_relaxed); }
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include <vector>
 #include <cstdint>
 #include <cstddef>
+#include "memory_policy.h"
 
 // NOTE: This class is NOT thread-safe.
 // Assumes single producer and single consumer :
@@ -11,7 +12,8 @@
 class stream_buffer {
 
     public:
-    stream_buffer(size_t buf_size) : capacity(buf_size), read(0), write(0), current_size(0) {
+    // policy: NUMA node / huge pages, default placement is first touch by the writing (worker) thread
+    stream_buffer(size_t buf_size, const memory_policy &policy = {}) : vec(policy_allocator<uint8_t>(policy)), capacity(buf_size), read(0), write(0), current_size(0) {
         vec.resize(capacity);
     }
     ~stream_buffer() = default;
@@ -23,7 +25,7 @@ class stream_buffer {
 
 
     private:
-    std::vector<uint8_t> vec;
+    std::vector<uint8_t, policy_allocator<uint8_t>> vec;
     size_t capacity;
     size_t read;
     size_t write;
@@ -0,0 +1,142 @@
+#ifndef _TICKET_GLOBAL_QUEUE_H_
+#define _TICKET_GLOBAL_QUEUE_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <stdexcept>
+#include <algorithm>
+#include "measurement.h"
+#include "memory_policy.h"
+#include "queue_concept.h"
+#include "cpu_relax.h"
+#include "queue_space_notifier.h"
+
+/*
+    Bounded MPSC queue where a producer claims its slot with fetch_add instead of a CAS loop.
+
+    lockless_global_queue: every producer CAS-es write, under a burst all but one fail, re-read the
+    slot seq and retry (no bound on retries). Here push() is:
+
+        1. admission: free_slots.fetch_sub(1), if there was no free slot add it back and return FULL
+        2. ticket:    t = write.fetch_add(1), slot t & mask
+        3. publish:   store the item, slot.seq = t + 1 (release)
+
+    Two RMWs, no retry loop, so push is wait free.
+    A ticket is only taken after admission succeeded, so a FULL or SHUTDOWN push never owns a position
+    that has to be given back (no rollback race, no tombstones).
+    The admission counter guarantees at most capacity items between admission and pop, and the consumer
+    frees slots in ticket order, so slot t & mask was already popped for lap t / capacity when ticket t is issued.
+    The producer still checks the slot seq and waits with cpu_relax() if it is not free yet
+    (a safety net, not expected to spin).
+
+    Consumer side: single consumer (same as sensor_manager / the consumer helpers), no CAS at all.
+    A producer that took a ticket but has not published yet holds back the items behind it (pop returns EMPTY
+    until it publishes), the same as the seq wait in lockless_global_queue.
+
+    Shutdown: push returns SHUTDOWN before taking a ticket, pop returns SHUTDOWN (items left in the queue
+    are discarded, same as lockless_global_queue).
+*/
+
+template <typename T>
+class ticket_global_queue
+{
+private:
+
+    struct alignas(64) slot {
+        std::atomic<uint64_t> seq;
+        T data;
+    };
+
+    policy_array<slot> vec;
+    alignas(64) std::atomic<int64_t> free_slots;
+    alignas(64) std::atomic<uint64_t> write;
+    alignas(64) uint64_t read; //consumer only
+    size_t total_capacity; // must be a power of 2
+    size_t mask;
+    std::atomic<bool> shut_down;
+    queue_space_notifier space;
+
+    static size_t validated_capacity(size_t capacity) {
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("illegal capacity value");
+        }
+        return capacity;
+    }
+
+public:
+    using value_type = T;
+
+    // capacity must be a power of 2, at least 2
+    // policy: NUMA node / huge pages for the slot array (see memory_policy.h)
+    ticket_global_queue(size_t capacity, const memory_policy &policy = {}): vec(validated_capacity(capacity), policy), free_slots(static_cast<int64_t>(capacity)), write(0), read(0), total_capacity(capacity), mask(capacity - 1), shut_down(false), space(capacity) {
+
+        for (size_t i = 0; i < total_capacity; i++) {
+            vec[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    size_t capacity() const { return total_capacity;}
+
+    // bytes per slot (payload heap memory not included)
+    static constexpr size_t slot_bytes() { return sizeof(slot); }
+
+    // approximate (admitted, not necessarily published items)
+    size_t size() const {
+        int64_t free = free_slots.load(std::memory_order_relaxed);
+        return total_capacity - static_cast<size_t>(std::clamp<int64_t>(free, 0, static_cast<int64_t>(total_capacity)));
+    }
+
+    // producers waiting for space after FULL (queue_space_notifier.h)
+    queue_space_notifier& space_notifier() { return space; }
+
+    queue_status push(T new_meas) {
+        if (shut_down.load(std::memory_order_relaxed)) {
+            return queue_status::SHUTDOWN;
+        }
+
+        //admission, acquire pairs with the consumer's release when it frees a slot
+        if (free_slots.fetch_sub(1, std::memory_order_acq_rel) <= 0) {
+            free_slots.fetch_add(1, std::memory_order_relaxed);
+            return queue_status::FULL;
+        }
+
+        uint64_t t = write.fetch_add(1, std::memory_order_relaxed);
+        slot &s = vec[t & mask];
+
+        while (s.seq.load(std::memory_order_acquire) != t) {
+            cpu_relax();
+        }
+
+        s.data = std::move(new_meas);
+        s.seq.store(t + 1, std::memory_order_release);
+        return queue_status::OK;
+    }
+
+    // single consumer
+    queue_status pop(T &meas) {
+        if (shut_down.load(std::memory_order_relaxed)) {
+            return queue_status::SHUTDOWN;
+        }
+
+        slot &s = vec[read & mask];
+        if (s.seq.load(std::memory_order_acquire) != read + 1) {
+            //empty, or the producer of this ticket has not published yet
+            return queue_status::EMPTY;
+        }
+
+        meas = std::move(s.data);
+        s.seq.store(read + total_capacity, std::memory_order_release);
+        read++;
+        free_slots.fetch_add(1, std::memory_order_release);
+        space.consumed([this] { return size(); });
+        return queue_status::OK;
+    }
+
+    void shutdown() {
+        shut_down.store(true, std::memory_order_release);
+        space.notify_all();
+    }
+};
+
+#endif
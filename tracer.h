@@ -0,0 +1,283 @@
+#ifndef _TRACER_H_
+#define _TRACER_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <system_error>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+    Pipeline event tracer, compiled in only with -DSENSOR_PIPELINE_TRACE.
+
+    Without the define the TRACE_* macros expand to nothing (arguments are not evaluated),
+    so the hot path is unchanged.
+
+    With the define:
+    - every thread that records gets its own SPSC ring of fixed size binary events
+      (owner thread writes, the dumper reads), recording is a few stores, no locks, no allocation
+    - a full ring drops the new event and counts it (tracer::dropped_events()), the producer never waits
+    - timestamps are raw TSC ticks (rdtsc, assumes an invariant TSC), steady_clock nanoseconds on other CPUs,
+      converted to microseconds only by the dumper
+    - trace_dumper drains the rings periodically on a background thread and writes Chrome trace JSON
+      (chrome://tracing, or ui.perfetto.dev which opens the same format)
+
+    Events are spans (start, end), instants have start == end:
+        READ     source read_bytes()                     value = bytes read (or the error)
+        PROCESS  stream buffer append + parse + push     value = bytes appended
+        PUSH     global queue push                       value = payload bytes, aux = queue_status
+        POP      consumer pop                            value = payload bytes
+
+    A ring lives until the process exits (threads are few and long lived), so events recorded
+    just before a thread exits are still dumped.
+*/
+
+enum class trace_event_type : uint8_t {
+    READ,
+    PROCESS,
+    PUSH,
+    POP
+};
+
+struct trace_event {
+    uint64_t start_tick;
+    uint64_t end_tick;
+    int64_t value;
+    uint32_t sensor_id;
+    trace_event_type type;
+    uint8_t aux;
+};
+
+namespace trace_clock {
+    inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+}
+
+class trace_ring
+{
+private:
+    static constexpr size_t capacity = 1 << 14; //events, power of 2
+    std::unique_ptr<trace_event[]> events;
+    uint32_t thread_index;
+    alignas(64) std::atomic<uint64_t> head; //written by the owner thread
+    uint64_t cached_tail; //owner thread only
+    std::atomic<size_t> dropped;
+    alignas(64) std::atomic<uint64_t> tail; //written by the dumper
+
+public:
+    trace_ring(uint32_t index) : events(new trace_event[capacity]), thread_index(index), head(0), cached_tail(0), dropped(0), tail(0) {}
+
+    // owner thread only
+    void push(const trace_event &e) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - cached_tail == capacity) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (h - cached_tail == capacity) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        events[h & (capacity - 1)] = e;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    // dumper thread only
+    template <typename F>
+    size_t drain(F &&f) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        uint64_t h = head.load(std::memory_order_acquire);
+        size_t n = static_cast<size_t>(h - t);
+        for (; t != h; t++) {
+            f(events[t & (capacity - 1)]);
+        }
+        tail.store(t, std::memory_order_release);
+        return n;
+    }
+
+    uint32_t index() const { return thread_index; }
+    size_t dropped_count() const { return dropped.load(std::memory_order_relaxed); }
+};
+
+class tracer
+{
+private:
+    std::mutex rings_mtx;
+    std::vector<std::unique_ptr<trace_ring>> rings;
+    uint64_t start_tick;
+    std::chrono::steady_clock::time_point start_time;
+
+    tracer() : start_tick(trace_clock::now()), start_time(std::chrono::steady_clock::now()) {}
+
+    trace_ring* register_thread() {
+        std::lock_guard<std::mutex> lock(rings_mtx);
+        rings.push_back(std::make_unique<trace_ring>(static_cast<uint32_t>(rings.size())));
+        return rings.back().get();
+    }
+
+    static trace_ring& local_ring() {
+        thread_local trace_ring *ring = instance().register_thread();
+        return *ring;
+    }
+
+public:
+    tracer(const tracer&) = delete;
+    tracer& operator=(const tracer&) = delete;
+
+    static tracer& instance() {
+        static tracer t;
+        return t;
+    }
+
+    static void record(trace_event_type type, size_t sensor_id, uint64_t start, uint64_t end, int64_t value, uint8_t aux = 0) {
+        local_ring().push(trace_event{start, end, value, static_cast<uint32_t>(sensor_id), type, aux});
+    }
+
+    // f(thread_index, event) for every pending event of every thread
+    template <typename F>
+    size_t drain_all(F &&f) {
+        std::lock_guard<std::mutex> lock(rings_mtx);
+        size_t n = 0;
+        for (auto &ring : rings) {
+            uint32_t index = ring->index();
+            n += ring->drain([&](const trace_event &e) { f(index, e); });
+        }
+        return n;
+    }
+
+    size_t dropped_events() {
+        std::lock_guard<std::mutex> lock(rings_mtx);
+        size_t n = 0;
+        for (auto &ring : rings) {
+            n += ring->dropped_count();
+        }
+        return n;
+    }
+
+    // tick -> microseconds since the tracer was created, the tick rate is measured against steady_clock
+    double ticks_per_us() const {
+        double elapsed_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_time).count();
+        uint64_t ticks = trace_clock::now() - start_tick;
+        return (elapsed_us > 0.0 && ticks > 0) ? static_cast<double>(ticks) / elapsed_us : 1.0;
+    }
+
+    double to_us(uint64_t tick, double rate) const {
+        return (tick > start_tick) ? static_cast<double>(tick - start_tick) / rate : 0.0;
+    }
+};
+
+/*
+    Background writer of Chrome trace JSON ("traceEvents" array, complete "X" events).
+    stop() (or the destructor) drains what is left and closes the file.
+    Throws std::system_error if the file cannot be created.
+*/
+class trace_dumper
+{
+private:
+    std::FILE *out;
+    std::chrono::milliseconds period;
+    bool first_event;
+    bool stop_req;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::thread dumper_thread;
+
+    static const char* event_name(const trace_event &e) {
+        switch (e.type)
+        {
+        case trace_event_type::READ:
+            return "read_bytes";
+        case trace_event_type::PROCESS:
+            return "process_bytes";
+        case trace_event_type::PUSH:
+            //aux is queue_status: OK, FULL, EMPTY, SHUTDOWN
+            return (e.aux == 1) ? "push_full" : (e.aux == 3) ? "push_shutdown" : "push";
+        case trace_event_type::POP:
+            return "pop";
+        default:
+            return "unknown";
+        }
+    }
+
+    void write_events() {
+        tracer &t = tracer::instance();
+        double rate = t.ticks_per_us();
+        t.drain_all([&](uint32_t thread_index, const trace_event &e) {
+            double ts = t.to_us(e.start_tick, rate);
+            double dur = (e.end_tick > e.start_tick) ? static_cast<double>(e.end_tick - e.start_tick) / rate : 0.0;
+            std::fprintf(out, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"sensor\":%u,\"value\":%lld}}",
+                first_event ? "" : ",", event_name(e), thread_index, ts, dur, e.sensor_id, static_cast<long long>(e.value));
+            first_event = false;
+        });
+        std::fflush(out);
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (!stop_req) {
+            cv.wait_for(lock, period, [this] { return stop_req; });
+            lock.unlock();
+            write_events();
+            lock.lock();
+        }
+    }
+
+public:
+    trace_dumper(const std::string &path, std::chrono::milliseconds drain_period = std::chrono::milliseconds(100)) : out(nullptr), period(drain_period), first_event(true), stop_req(false) {
+        out = std::fopen(path.c_str(), "w");
+        if (out == nullptr) {
+            throw std::system_error(errno, std::generic_category(), "trace file open failed ");
+        }
+        std::fputs("{\"traceEvents\":[", out);
+        dumper_thread = std::thread(&trace_dumper::run, this);
+    }
+
+    ~trace_dumper() {
+        stop();
+    }
+
+    trace_dumper(const trace_dumper&) = delete;
+    trace_dumper& operator=(const trace_dumper&) = delete;
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (out == nullptr) {
+                return;
+            }
+            stop_req = true;
+        }
+        cv.notify_one();
+        dumper_thread.join();
+        std::fprintf(out, "\n],\"otherData\":{\"dropped_events\":%zu}}\n", tracer::instance().dropped_events());
+        std::fclose(out);
+        out = nullptr;
+    }
+};
+
+#ifdef SENSOR_PIPELINE_TRACE
+#define TRACE_BEGIN(span) const uint64_t span = trace_clock::now()
+#define TRACE_END(span, type, sensor, value, aux) tracer::record(trace_event_type::type, (sensor), span, trace_clock::now(), static_cast<int64_t>(value), static_cast<uint8_t>(aux))
+#define TRACE_INSTANT(type, sensor, value) do { uint64_t trace_now_ = trace_clock::now(); tracer::record(trace_event_type::type, (sensor), trace_now_, trace_now_, static_cast<int64_t>(value)); } while (0)
+#else
+#define TRACE_BEGIN(span) do {} while (0)
+#define TRACE_END(span, type, sensor, value, aux) do {} while (0)
+#define TRACE_INSTANT(type, sensor, value) do {} while (0)
+#endif
+
+#endif
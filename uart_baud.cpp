@@ -0,0 +1,45 @@
+#include "uart_baud.h"
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+#include <system_error>
+#include <cerrno>
+
+/*
+uart_set_baud():
+- BOTHER in c_cflag tells the driver to take the rate from c_ispeed / c_ospeed as an integer
+  instead of one of the Bxxx constants, any rate the UART clock divider can produce is accepted.
+- The driver rounds to the closest rate it can generate, the caller validates the read back value.
+*/
+unsigned int uart_set_baud(int fd, unsigned int baud) {
+
+    struct termios2 tio {};
+
+    if (ioctl(fd, TCGETS2, &tio) != 0) {
+        throw std::system_error(errno, std::generic_category(), "TCGETS2 failed ");
+    }
+
+    tio.c_cflag &= ~CBAUD;
+    tio.c_cflag |= BOTHER;
+    tio.c_cflag &= ~(CBAUD << IBSHIFT);
+    tio.c_cflag |= (BOTHER << IBSHIFT);
+    tio.c_ispeed = baud;
+    tio.c_ospeed = baud;
+
+    if (ioctl(fd, TCSETS2, &tio) != 0) {
+        throw std::system_error(errno, std::generic_category(), "TCSETS2 failed ");
+    }
+
+    return uart_get_baud(fd);
+}
+
+
+unsigned int uart_get_baud(int fd) {
+
+    struct termios2 tio {};
+
+    if (ioctl(fd, TCGETS2, &tio) != 0) {
+        throw std::system_error(errno, std::generic_category(), "TCGETS2 failed ");
+    }
+
+    return tio.c_ospeed;
+}
@@ -0,0 +1,20 @@
+#ifndef _UART_BAUD_H_
+#define _UART_BAUD_H_
+
+#include <cstdint>
+
+/*
+    Arbitrary baud rates through termios2 / BOTHER (TCSETS2).
+
+    <asm/termbits.h> (struct termios2) clashes with glibc <termios.h>, so these live in their own
+    translation unit (uart_baud.cpp) and only plain ints cross this header.
+
+    Both functions throw std::system_error when the ioctl fails.
+*/
+
+// sets input and output speed of an open tty to baud bits/s, returns the rate the driver reports back
+unsigned int uart_set_baud(int fd, unsigned int baud);
+
+unsigned int uart_get_baud(int fd);
+
+#endif
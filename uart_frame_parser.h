@@ -1,7 +1,28 @@
+#ifndef _UART_FRAME_PARSER_H_
+#define _UART_FRAME_PARSER_H_
+
 #include "frame_parser.h"
 #include <cassert>
 #include <deque>
 
+/*
+    uart_parser_config:
+
+    backtrack_resync: on a bad length byte or CRC failure, rescan from the byte after the failed sync
+                      instead of from the byte after the bad frame. A real 0xAA frame that started inside
+                      the bogus frame is then recovered instead of lost.
+                      The lookback window holds the bytes of the current candidate frame(s), at most
+                      two frames (max_frame_size each), so the extra work per failure is bounded.
+
+    confirm_lock:     after start-up or any failure the parser is unlocked, a valid frame is only emitted
+                      once the next frame (starting right after it) is valid too. Protects against locking
+                      on a 0xAA byte inside payload data whose "frame" happens to pass the 8 bit CRC.
+*/
+struct uart_parser_config {
+    bool backtrack_resync = false;
+    bool confirm_lock = false;
+};
+
 class uart_frame_parser : public frame_parser
 {
 private:
@@ -13,18 +34,32 @@ enum parsing_states {
     READ_CRC
 };
 
+uart_parser_config conf;
 size_t frames_dropped;
 size_t error_counter;
+size_t resync_attempts;
+size_t recovered_frames;
+size_t unconfirmed_drops;
 parsing_states parse_state;
 size_t payload_len;
 size_t payload_index;
 uint8_t crc_acc;
+bool locked;
+bool in_replay;
+bool frame_recovered; //current frame's sync byte came from a rescan
+bool has_tentative;
+bool tentative_recovered;
 static constexpr size_t measurements_buffer_size = 4; 
 static constexpr size_t max_payload_len = 64; //bytes
+static constexpr size_t max_frame_size = max_payload_len + 3; //sync + len + payload + crc
 static constexpr uint8_t sync = 0xAA;
 static constexpr uint8_t polynomial = 0x07;
 std::vector<uint8_t> measurement_bytes;
 std::deque<measurement> measurements_buffer;
+measurement tentative;
+std::vector<uint8_t> window; //raw bytes since the oldest unconfirmed sync (backtrack_resync only)
+std::vector<uint8_t> replay; //bytes to rescan after a failure
+size_t replay_pos;
 
 static void update_crc(uint8_t &crc_acc, uint8_t payload_byte) {
     crc_acc ^= payload_byte;
@@ -40,8 +75,143 @@ static void update_crc(uint8_t &crc_acc, uint8_t payload_byte) {
     }
 }
 
+void record(uint8_t b) {
+    if (conf.backtrack_resync) {
+        window.push_back(b);
+    }
+}
+
+void emit(measurement &&m, bool recovered) {
+    if (measurements_buffer.size() < measurements_buffer_size) {
+        if (recovered) {
+            recovered_frames++;
+        }
+        measurements_buffer.push_back(std::move(m));
+    }
+    else {
+        frames_dropped++;
+    }
+}
+
+//bad length / CRC / unconfirmed lock: back to WAIT_SYNC, optionally rescan the window from the byte after its sync
+void fail() {
+    if (has_tentative) {
+        has_tentative = false;
+        unconfirmed_drops++;
+    }
+    locked = false;
+    parse_state = WAIT_SYNC;
+    crc_acc = 0;
+
+    if (conf.backtrack_resync && !window.empty()) {
+        resync_attempts++;
+        replay.insert(replay.begin() + replay_pos, window.begin() + 1, window.end());
+    }
+    window.clear();
+}
+
+void frame_complete() {
+    measurement m;
+    measurement_bytes.resize(payload_len);
+    m.payload = std::move(measurement_bytes);
+    measurement_bytes.clear();
+
+    if (!conf.confirm_lock || locked) {
+        emit(std::move(m), frame_recovered);
+        window.clear();
+        return;
+    }
+
+    if (!has_tentative) {
+        //keep the window, if the next frame fails the rescan starts inside this one
+        tentative = std::move(m);
+        tentative_recovered = frame_recovered;
+        has_tentative = true;
+        return;
+    }
+
+    //second consecutive valid frame confirms the first
+    locked = true;
+    has_tentative = false;
+    emit(std::move(tentative), tentative_recovered);
+    emit(std::move(m), frame_recovered);
+    window.clear();
+}
+
+//consumes exactly one byte
+void step(uint8_t b) {
+    if (parse_state == WAIT_SYNC) {
+        if (b != sync) {
+            if (has_tentative) {
+                //a confirming frame must start right after the tentative one
+                record(b);
+                fail();
+            }
+            return;
+        }
+
+        if (!has_tentative) {
+            window.clear();
+        }
+        record(b);
+        frame_recovered = in_replay;
+        parse_state = READ_LEN;
+        crc_acc = 0;
+        return;
+    }
+
+    record(b);
+    switch (parse_state) {
+        case(READ_LEN):
+            payload_len = b;
+            if (payload_len > max_payload_len) {
+                //failed, resync
+                fail();
+                if (!conf.backtrack_resync) {
+                    //the length byte itself may be the next sync
+                    step(b);
+                }
+                break;
+            }
+
+            if (measurement_bytes.size() < payload_len) {
+                measurement_bytes.resize(payload_len);
+            }
+
+            payload_index = 0;
+            parse_state = (payload_len == 0) ? READ_CRC : READ_PAYLOAD;
+            break;
+
+        case(READ_PAYLOAD):
+            update_crc(crc_acc, b);
+            measurement_bytes[payload_index++] = b;
+            if (payload_index == payload_len) {
+                parse_state = READ_CRC;
+            }
+            break;
+
+        case(READ_CRC):
+            if (b != crc_acc) {
+                error_counter++;
+                fail();
+                break;
+            }
+            parse_state = WAIT_SYNC;
+            crc_acc = 0;
+            frame_complete();
+            break;
+
+        default:
+            break;
+    };
+}
+
 public:
-    uart_frame_parser(/* args */) : frames_dropped(0), error_counter(0),  parse_state(WAIT_SYNC), payload_len(0), payload_index(0), crc_acc(0) {
+    uart_frame_parser(const uart_parser_config &config = {}) : conf(config), frames_dropped(0), error_counter(0), resync_attempts(0), recovered_frames(0), unconfirmed_drops(0), parse_state(WAIT_SYNC), payload_len(0), payload_index(0), crc_acc(0), locked(false), in_replay(false), frame_recovered(false), has_tentative(false), tentative_recovered(false), replay_pos(0) {
+        if (conf.backtrack_resync) {
+            window.reserve(2 * max_frame_size);
+            replay.reserve(2 * max_frame_size);
+        }
     }
 
     ~uart_frame_parser() {
@@ -49,77 +219,20 @@ public:
     }
 
     void feed_bytes(const uint8_t *chunk, size_t len) override {
-        size_t index = 0;
-        //starting state machine
-        while (index < len) {
-            switch (parse_state) {
-                case(WAIT_SYNC):
-
-                    if (chunk[index] != sync) {
-                        index++;
-                        break;
-                    }
-
-                    parse_state = READ_LEN;
-                    index++;
-                    crc_acc = 0;
-                    break;
-
-                case(READ_LEN):
-                    
-                    payload_len = chunk[index];
-                    if (payload_len > max_payload_len) {
-                        //failed, resync
-                        parse_state = WAIT_SYNC;
-                        break;
-                    }
-
-                    if (measurement_bytes.size() < payload_len) {
-                        measurement_bytes.resize(payload_len);
-                    }
-
-                    payload_index = 0;
-                    parse_state = READ_PAYLOAD;
-                    index++;                
-                    break;
-
-                case(READ_PAYLOAD):
-
-                    if(payload_index < payload_len) {
-                        update_crc(crc_acc, chunk[index]);
-                        measurement_bytes[payload_index++] = chunk[index++];
-                    }
-                    if (payload_index == payload_len) {
-                        parse_state = READ_CRC;
-                    }
-                    break;
-
-                case(READ_CRC):
-                    if (chunk[index] == crc_acc) {
-                        crc_acc = 0;
-                        if (measurements_buffer.size() < measurements_buffer_size) {
-
-                            measurement m;
-                            m.payload = std::move(measurement_bytes);
-                            measurement_bytes.clear();
-                            measurements_buffer.push_back(std::move(m));
-                        }
-                        else {
-                            frames_dropped++;
-                        }
-                    }
-                    else {
-                        error_counter++;
-                        crc_acc = 0;
-
-                    }
-
-                    parse_state = WAIT_SYNC;
-                    index++;
-                    break;
-            };
+        for (size_t index = 0; index < len; index++) {
+            step(chunk[index]);
+
+            //rescan after a failure, a rescan may fail again and queue a shorter rescan
+            if (!replay.empty()) {
+                in_replay = true;
+                while (replay_pos < replay.size()) {
+                    step(replay[replay_pos++]);
+                }
+                replay.clear();
+                replay_pos = 0;
+                in_replay = false;
+            }
         }
-        return;
     }
 
     // Caller must call has_frame() before extract_frame().
@@ -138,6 +251,28 @@ public:
         return error_counter;
     }
 
+    size_t scratch_bytes() const override {
+        size_t bytes = (measurements_buffer_size + 2) * max_payload_len; //buffered frames + tentative + scratch
+        if (conf.backtrack_resync) {
+            bytes += 4 * max_frame_size; //window + replay
+        }
+        return bytes;
+    }
+
+    size_t resync_attempt_count() const {
+        return resync_attempts;
+    }
+
+    // frames whose sync byte was found by a rescan (lost without backtrack_resync)
+    size_t recovered_frame_count() const {
+        return recovered_frames;
+    }
+
+    // CRC-valid frames dropped because the following frame did not confirm the lock
+    size_t unconfirmed_drop_count() const {
+        return unconfirmed_drops;
+    }
+
     bool has_capacity() const override {
         return (measurements_buffer.size() < measurements_buffer_size);
     }
@@ -154,3 +289,4 @@ public:
 
 };
 
+#endif
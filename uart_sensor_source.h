@@ -1,3 +1,6 @@
+#ifndef _UART_SENSOR_SOURCE_H_
+#define _UART_SENSOR_SOURCE_H_
+
 #include "sensor_source.h"
 #include "unique_fd.h"
 #include <unistd.h>
@@ -10,6 +13,13 @@
 #include <poll.h>
 #include <sys/eventfd.h>
 #include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+#include "cpu_relax.h"
+#include "uart_baud.h"
 
 /*
     std::system_error for syscall failures
@@ -20,12 +30,38 @@ enum class data_bits {seven = 7, eight = 8};
 enum class parity {N, E, O};
 enum class stop_bits {one , two};
 
+/*
+    Low latency mode (opt-in):
+    busy_poll: read_bytes() first spins on the non-blocking read() for spin_budget, and only then
+               falls back to poll(). Saves the poll syscall and the sleep/wake cycle when bytes
+               arrive within the budget, at the cost of one busy core per sensor while spinning.
+               A stop request is seen through an atomic counter while spinning (no syscall).
+    kernel_low_latency: set ASYNC_LOW_LATENCY on the serial driver (TIOCSSERIAL), the tty layer then
+               pushes received bytes to the reader immediately instead of from a deferred work item.
+               Silently skipped for drivers that do not support it (pty, most USB serial adapters),
+               check kernel_low_latency_enabled().
+*/
+struct uart_low_latency_config {
+    bool busy_poll = false;
+    std::chrono::microseconds spin_budget{50};
+    bool kernel_low_latency = false;
+};
+
+/*
+    baud_rate: any positive integer rate (termios2 / BOTHER), e.g. 1500000, 3000000, 4000000.
+               The rate applied by the driver is read back and must be within max_baud_error_percent.
+    read_window: read size policy, preferred_read_size() is the number of bytes the line can deliver
+               in read_window at baud_rate (never less than min_read_size), so the number of read()
+               calls per second stays about the same at any baud rate.
+*/
 struct uart_config {
     std::string device;
     int baud_rate;
     data_bits d_bits;
     parity par;
     stop_bits s_bits;
+    uart_low_latency_config low_latency{};
+    std::chrono::microseconds read_window{4000};
 };
 
 class uart_sensor_source : public sensor_source
@@ -33,32 +69,90 @@ class uart_sensor_source : public sensor_source
 private:
     unique_fd u_stopfd;
     unique_fd u_fd;
+    uart_low_latency_config ll_conf;
+    std::atomic<int64_t> stop_pending; //eventfd writes minus drained counts, a reader may briefly take it below 0
+    bool kernel_low_latency;
+
+    bool enable_kernel_low_latency() {
+        serial_struct serial{};
+        if (ioctl(u_fd.get(), TIOCGSERIAL, &serial) != 0) {
+            return false;
+        }
+        serial.flags |= ASYNC_LOW_LATENCY;
+        return ioctl(u_fd.get(), TIOCSSERIAL, &serial) == 0;
+    }
 
-    static speed_t to_speed(int baud) {
-        switch(baud) {
-            case 9600:
-                return B9600;
-            case 19200:
-                return B19200;
-            case 38400:
-                return B38400;
-            case 57600:
-                return B57600;    
-            case 115200:
-                return B115200;
-            case 230400:
-                return B230400;  
-            case 576000:
-                return B576000;       
-            case 921600:
-                return B921600;
-            default:
-                throw std::invalid_argument("unsuported baud rate");            
+    /*
+        consumes the pending stop requests: drains the eventfd (non-blocking, until EAGAIN) and takes the
+        drained count off stop_pending. Returns false when there was nothing to drain.
+        stop_request() writes the eventfd before it increments stop_pending, so stop_pending > 0 always has
+        an eventfd count behind it, and a drain that overtakes an increment only takes stop_pending below 0
+        until the increment lands. Overlapping stop requests leave neither a count nor a pending stop behind.
+    */
+    bool consume_stop_request() {
+        uint64_t v;
+        uint64_t drained = 0;
+        while (read(u_stopfd.get(), &v, sizeof(v)) == sizeof(v)) {
+            drained += v;
+        }
+        if (drained == 0) {
+            return false;
+        }
+        stop_pending.fetch_sub(static_cast<int64_t>(drained), std::memory_order_acq_rel);
+        return true;
+    }
+
+    /*
+        busy poll phase of read_bytes(): non-blocking read() until data, stop or spin_budget elapsed.
+        Returns would_block when the budget ran out.
+    */
+    ssize_t spin_read(uint8_t* buf, size_t buf_len) {
+        auto deadline = std::chrono::steady_clock::now() + ll_conf.spin_budget;
+        size_t iterations = 0;
+
+        while (true) {
+            if (stop_pending.load(std::memory_order_acquire) > 0) {
+                consume_stop_request();
+                return 0;
+            }
+
+            ssize_t ret = read(u_fd.get(), buf, buf_len);
+            if (ret > 0) {
+                return ret;
+            }
+            if (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                return -1;
+            }
+
+            cpu_relax();
+            //reading the clock is cheap (vDSO) but not free, check it every few rounds
+            if ((++iterations & 0x3F) == 0 && std::chrono::steady_clock::now() >= deadline) {
+                return would_block;
+            }
         }
     }
 
+    static constexpr unsigned int max_baud_error_percent = 2;
+    static constexpr size_t min_read_size = 256; //bytes
+    static constexpr size_t max_read_size = 64 * 1024; //bytes
+
+    static unsigned int validated_baud(int baud) {
+        if (baud <= 0) {
+            throw std::invalid_argument("unsuported baud rate");
+        }
+        return static_cast<unsigned int>(baud);
+    }
+
+    //bits on the wire per byte: start + data + parity + stop
+    static size_t bits_per_byte(const uart_config& uart_conf) {
+        return 1 + static_cast<size_t>(uart_conf.d_bits) + (uart_conf.par == parity::N ? 0 : 1) + (uart_conf.s_bits == stop_bits::one ? 1 : 2);
+    }
+
+    size_t read_size;
+    unsigned int actual_baud;
+
 public:
-    uart_sensor_source(const uart_config& uart_conf) {
+    uart_sensor_source(const uart_config& uart_conf) : ll_conf(uart_conf.low_latency), stop_pending(0), kernel_low_latency(false), read_size(min_read_size), actual_baud(0) {
 
         /*open file descriptor:
             O_RDWR: you can read/write (needed for UART config sometimes)
@@ -91,11 +185,6 @@ public:
         //set raw mode
         cfmakeraw(&termio);
 
-        //set baud_rate
-        speed_t sp = to_speed(uart_conf.baud_rate);
-        cfsetispeed(&termio, sp);
-        cfsetospeed(&termio, sp);        
-
         //clear the c_c bits (bit 4 and 5)
         termio.c_cflag &= ~CSIZE; 
 
@@ -139,18 +228,61 @@ public:
         if (tcsetattr(u_fd.get(), TCSANOW, &termio) != 0) {
             throw std::system_error(errno,std::generic_category() ,"tcsetattr failed ");
         }
+
+        //set baud_rate (termios2, any integer rate) and validate what the driver applied
+        unsigned int baud = validated_baud(uart_conf.baud_rate);
+        actual_baud = uart_set_baud(u_fd.get(), baud);
+        unsigned int baud_error = (actual_baud > baud) ? actual_baud - baud : baud - actual_baud;
+        if (static_cast<uint64_t>(baud_error) * 100 > static_cast<uint64_t>(baud) * max_baud_error_percent) {
+            throw std::runtime_error("baud rate not supported by the uart driver");
+        }
+
+        //read size policy: bytes per read_window at the line rate
+        uint64_t bytes_per_window = static_cast<uint64_t>(actual_baud) / bits_per_byte(uart_conf) * static_cast<uint64_t>(uart_conf.read_window.count()) / 1000000;
+        read_size = std::clamp(static_cast<size_t>(bytes_per_window), min_read_size, max_read_size);
+
+        if (ll_conf.kernel_low_latency) {
+            kernel_low_latency = enable_kernel_low_latency();
+        }
+    }
+
+    bool kernel_low_latency_enabled() const {
+        return kernel_low_latency;
+    }
+
+    unsigned int get_actual_baud() const {
+        return actual_baud;
+    }
+
+    size_t preferred_read_size() const override {
+        return read_size;
     }
 
     virtual ssize_t read_bytes(uint8_t* buf, size_t buf_len) override {
-        pollfd plfd[2]{};
+        return read_bytes_or_wake(buf, buf_len, -1);
+    }
+
+    // wake_fd < 0 => plain read_bytes()
+    ssize_t read_bytes_or_wake(uint8_t* buf, size_t buf_len, int wake_fd) override {
+        if (ll_conf.busy_poll) {
+            ssize_t ret = spin_read(buf, buf_len);
+            if (ret != would_block) {
+                return ret;
+            }
+        }
+
+        pollfd plfd[3]{};
         plfd[0].fd = u_fd.get();
         plfd[1].fd = u_stopfd.get();
+        plfd[2].fd = wake_fd;
         plfd[0].events = POLLIN;
         plfd[1].events = POLLIN;    
+        plfd[2].events = POLLIN;
+        nfds_t nfds = (wake_fd >= 0) ? 3 : 2;
     
         while (true) {
 
-            int rc = poll(&plfd[0], 2, -1); //block until:  data in Rx buffer / stop request
+            int rc = poll(&plfd[0], nfds, -1); //block until:  data in Rx buffer / stop request / queue space
 
             if (rc < 0) {
                 if (errno == EINTR) continue;
@@ -158,9 +290,7 @@ public:
             }
 
             //stop request
-            if (plfd[1].revents & POLLIN) {
-                uint64_t v;
-                read(u_stopfd.get(), &v, sizeof(v)); //set event_fd back to 0 so next call to poll it will block. 
+            if ((plfd[1].revents & POLLIN) && consume_stop_request()) { //set event_fd back to 0 so next call to poll it will block.
                 return 0; // signal stop
             }               
 
@@ -182,9 +312,14 @@ public:
                 return -1;
             }
 
-            //(stop event: event_fd error cases
-            if (plfd[1].revents & (POLLERR | POLLHUP | POLLNVAL)) {
-                return -1;
+            //queue has space again, data first so the bytes are not left waiting
+            if (plfd[2].revents & POLLIN) {
+                return woken;
+            }
+
+            //stop eventfd / queue space fd unusable: poll() would return at once forever, stop instead
+            if ((plfd[1].revents & (POLLERR | POLLHUP | POLLNVAL)) || (plfd[2].revents & (POLLERR | POLLNVAL))) {
+                return 0;
             }
 
             // UART error cases
@@ -196,6 +331,37 @@ public:
         return 0;
     }
 
+    std::vector<int> pollable_fds() const override {
+        return {u_fd.get(), u_stopfd.get()};
+    }
+
+    //non-blocking variant of read_bytes(), the caller waits on pollable_fds() instead of poll() here
+    ssize_t try_read_bytes(uint8_t* buf, size_t buf_len) override {
+        //stop request has priority over pending data (same as read_bytes)
+        if (consume_stop_request()) {
+            return 0;
+        }
+
+        while (true) {
+            ssize_t ret = read(u_fd.get(), buf, buf_len);
+
+            if (ret >= 0) {
+                return ret;
+            }
+
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return would_block;
+            }
+
+            return -1;
+        }
+    }
+
+    //every call ends exactly one read (the pending one or the next one), calls are neither lost nor merged
     virtual int stop_request() override {
         //setting event_fd counter > 0 will result in poll function return (in the read_bytes func)
         uint64_t eventfd_counter = 1;
@@ -205,8 +371,10 @@ public:
             return -1;
         }
 
+        //after the eventfd: a busy polling reader sees it without a syscall and drains the count it pairs with
+        stop_pending.fetch_add(1, std::memory_order_acq_rel);
         return 0;
     }
 };
 
-
+#endif
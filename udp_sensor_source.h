@@ -0,0 +1,283 @@
+#ifndef _UDP_SENSOR_SOURCE_H_
+#define _UDP_SENSOR_SOURCE_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "unique_fd.h"
+#include "packet_source.h"
+
+/*
+    packet_source for UDP sensor gateways: one datagram is one measurement payload (packet_worker.h).
+
+    read_packets(): poll(socket, stop eventfd), then one recvmmsg() receives up to batch datagrams
+    into a contiguous receive arena, then each datagram is copied into its packets[i].
+
+    Timestamps: with kernel_timestamps the socket has SO_TIMESTAMPNS, each datagram carries the
+    CLOCK_REALTIME time the kernel received it. It is mapped to steady_clock by its age
+    (steady_now - (realtime_now - kernel_ts)), so time spent in the socket buffer is not hidden.
+    Without it (or when the cmsg is missing) the receive time is steady_clock::now() after the batch.
+
+    Socket options:
+    - rcvbuf_bytes: SO_RCVBUF (0 => system default), the kernel doubles the value, capped by net.core.rmem_max
+    - reuseport: SO_REUSEPORT, several sources (one per worker) bound to the same port, the kernel
+      spreads the datagrams over them by flow hash
+    - SO_RXQ_OVFL is always enabled: datagrams the kernel dropped because this socket's buffer was full
+      (get_kernel_drops())
+
+    Datagrams longer than max_packet_size are dropped and counted (get_truncated_count()).
+    The counters are relaxed atomics, they can be read while the worker runs (packets/s reporting).
+
+    std::system_error when the socket / eventfd cannot be created or bound.
+*/
+
+struct udp_config {
+    std::string bind_address = "0.0.0.0"; //IPv4
+    uint16_t port = 0; //0 => ephemeral, see local_port()
+    size_t max_packet_size = 2048; //bytes
+    size_t batch = 32; //datagrams per recvmmsg()
+    int rcvbuf_bytes = 0; //SO_RCVBUF, 0 => system default
+    bool reuseport = false; //SO_REUSEPORT fan-out across workers
+    bool kernel_timestamps = true; //SO_TIMESTAMPNS
+};
+
+class udp_sensor_source : public packet_source
+{
+private:
+    //SCM_TIMESTAMPNS + SO_RXQ_OVFL
+    static constexpr size_t control_size = CMSG_SPACE(sizeof(timespec)) + CMSG_SPACE(sizeof(uint32_t));
+
+    unique_fd u_fd;
+    unique_fd u_stopfd;
+    size_t max_packet;
+    size_t batch_size;
+    std::vector<uint8_t> arena;
+    std::vector<uint8_t> control;
+    std::vector<iovec> iovecs;
+    std::vector<mmsghdr> msgs;
+    std::atomic<size_t> packets_received;
+    std::atomic<size_t> bytes_received;
+    std::atomic<size_t> truncated;
+    std::atomic<uint32_t> kernel_drops;
+
+    static size_t validated(size_t v, const char *what) {
+        if (v == 0) {
+            throw std::invalid_argument(what);
+        }
+        return v;
+    }
+
+    void set_option(int level, int name, int value, const char *what) {
+        if (setsockopt(u_fd.get(), level, name, &value, sizeof(value)) != 0) {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+    }
+
+    void reset_headers() {
+        for (size_t i = 0; i < batch_size; i++) {
+            msgs[i].msg_hdr.msg_control = control.data() + i * control_size;
+            msgs[i].msg_hdr.msg_controllen = control_size;
+            msgs[i].msg_hdr.msg_flags = 0;
+        }
+    }
+
+    // kernel receive time (CLOCK_REALTIME) of message i, false when the cmsg is missing
+    // also picks up the SO_RXQ_OVFL drop counter
+    bool parse_control(msghdr &hdr, timespec &kernel_ts) {
+        bool has_ts = false;
+        for (cmsghdr *cm = CMSG_FIRSTHDR(&hdr); cm != nullptr; cm = CMSG_NXTHDR(&hdr, cm)) {
+            if (cm->cmsg_level != SOL_SOCKET) {
+                continue;
+            }
+            if (cm->cmsg_type == SCM_TIMESTAMPNS) {
+                std::memcpy(&kernel_ts, CMSG_DATA(cm), sizeof(timespec));
+                has_ts = true;
+            }
+            else if (cm->cmsg_type == SO_RXQ_OVFL) {
+                //cumulative count for the socket
+                uint32_t drops;
+                std::memcpy(&drops, CMSG_DATA(cm), sizeof(drops));
+                kernel_drops.store(drops, std::memory_order_relaxed);
+            }
+        }
+        return has_ts;
+    }
+
+public:
+    udp_sensor_source(const udp_config &conf) : max_packet(validated(conf.max_packet_size, "illegal packet size")), batch_size(validated(conf.batch, "illegal batch size")), packets_received(0), bytes_received(0), truncated(0), kernel_drops(0) {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(conf.port);
+        if (inet_pton(AF_INET, conf.bind_address.c_str(), &addr.sin_addr) != 1) {
+            throw std::invalid_argument("illegal bind address");
+        }
+
+        int tmp_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (tmp_fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "socket failed ");
+        }
+        u_fd.reset(tmp_fd);
+
+        if (conf.reuseport) {
+            set_option(SOL_SOCKET, SO_REUSEPORT, 1, "SO_REUSEPORT failed ");
+        }
+        if (conf.rcvbuf_bytes > 0) {
+            set_option(SOL_SOCKET, SO_RCVBUF, conf.rcvbuf_bytes, "SO_RCVBUF failed ");
+        }
+        if (conf.kernel_timestamps) {
+            set_option(SOL_SOCKET, SO_TIMESTAMPNS, 1, "SO_TIMESTAMPNS failed ");
+        }
+        set_option(SOL_SOCKET, SO_RXQ_OVFL, 1, "SO_RXQ_OVFL failed ");
+
+        if (bind(u_fd.get(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            throw std::system_error(errno, std::generic_category(), "bind failed ");
+        }
+
+        tmp_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (tmp_fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "eventfd failed ");
+        }
+        u_stopfd.reset(tmp_fd);
+
+        arena.resize(batch_size * max_packet);
+        control.resize(batch_size * control_size);
+        iovecs.resize(batch_size);
+        msgs.resize(batch_size);
+        for (size_t i = 0; i < batch_size; i++) {
+            iovecs[i].iov_base = arena.data() + i * max_packet;
+            iovecs[i].iov_len = max_packet;
+            std::memset(&msgs[i], 0, sizeof(mmsghdr));
+            msgs[i].msg_hdr.msg_iov = &iovecs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+    ssize_t read_packets(std::vector<uint8_t> *packets, std::chrono::steady_clock::time_point *timestamps, size_t max_packets) override {
+        unsigned int want = static_cast<unsigned int>(std::min(max_packets, batch_size));
+        if (want == 0) {
+            return -1;
+        }
+
+        pollfd plfd[2]{};
+        plfd[0].fd = u_fd.get();
+        plfd[1].fd = u_stopfd.get();
+        plfd[0].events = POLLIN;
+        plfd[1].events = POLLIN;
+
+        while (true) {
+            int rc = poll(&plfd[0], 2, -1); //block until: datagram / stop request
+
+            if (rc < 0) {
+                if (errno == EINTR) continue;
+                return -1;
+            }
+
+            //stop request
+            if (plfd[1].revents & POLLIN) {
+                uint64_t v;
+                read(u_stopfd.get(), &v, sizeof(v));
+                return 0;
+            }
+
+            if (plfd[0].revents & (POLLERR | POLLNVAL) || plfd[1].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                return -1;
+            }
+
+            if (!(plfd[0].revents & POLLIN)) {
+                continue;
+            }
+
+            reset_headers();
+            int n = recvmmsg(u_fd.get(), msgs.data(), want, MSG_DONTWAIT, nullptr);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+
+            //both clocks read once per batch, kernel timestamps are mapped by their age
+            auto steady_now = std::chrono::steady_clock::now();
+            timespec real_now;
+            clock_gettime(CLOCK_REALTIME, &real_now);
+
+            size_t out = 0;
+            size_t bytes = 0;
+            for (int i = 0; i < n; i++) {
+                msghdr &hdr = msgs[i].msg_hdr;
+                timespec kernel_ts;
+                bool has_ts = parse_control(hdr, kernel_ts);
+
+                if (hdr.msg_flags & MSG_TRUNC) {
+                    truncated.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                timestamps[out] = steady_now;
+                if (has_ts) {
+                    auto age = std::chrono::seconds(real_now.tv_sec - kernel_ts.tv_sec) + std::chrono::nanoseconds(real_now.tv_nsec - kernel_ts.tv_nsec);
+                    if (age.count() > 0) {
+                        timestamps[out] -= std::chrono::duration_cast<std::chrono::steady_clock::duration>(age);
+                    }
+                }
+
+                const uint8_t *data = arena.data() + static_cast<size_t>(i) * max_packet;
+                packets[out++].assign(data, data + msgs[i].msg_len);
+                bytes += msgs[i].msg_len;
+            }
+
+            packets_received.fetch_add(out, std::memory_order_relaxed);
+            bytes_received.fetch_add(bytes, std::memory_order_relaxed);
+            if (out > 0) {
+                return static_cast<ssize_t>(out);
+            }
+        }
+    }
+
+    int stop_request() override {
+        uint64_t one = 1;
+        if (write(u_stopfd.get(), &one, sizeof(one)) != sizeof(one)) {
+            return -1;
+        }
+        return 0;
+    }
+
+    size_t max_packet_size() const override { return max_packet; }
+    size_t max_batch() const override { return batch_size; }
+
+    // bound port (useful with port 0)
+    uint16_t local_port() const {
+        sockaddr_in addr{};
+        socklen_t len = sizeof(addr);
+        if (getsockname(u_fd.get(), reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+            return 0;
+        }
+        return ntohs(addr.sin_port);
+    }
+
+    size_t get_packets_count() const { return packets_received.load(std::memory_order_relaxed); }
+    size_t get_bytes_count() const { return bytes_received.load(std::memory_order_relaxed); }
+
+    // datagrams dropped because they did not fit in max_packet_size
+    size_t get_truncated_count() const { return truncated.load(std::memory_order_relaxed); }
+
+    // datagrams the kernel dropped on this socket (receive buffer full), last SO_RXQ_OVFL value seen
+    size_t get_kernel_drops() const { return kernel_drops.load(std::memory_order_relaxed); }
+};
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef _UNIQUE_FD_H_
+#define _UNIQUE_FD_H_
+
 #include <unistd.h>
 
 class unique_fd
@@ -71,3 +74,5 @@ public:
         return ret_fd;
     }
 };
+
+#endif
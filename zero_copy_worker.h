@@ -0,0 +1,278 @@
+#ifndef _ZERO_COPY_WORKER_H_
+#define _ZERO_COPY_WORKER_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <concepts>
+#include <stdexcept>
+#include <poll.h>
+#include "sensor_source.h"
+#include "segment_pool.h"
+#include "frame_scanner.h"
+#include "queue_concept.h"
+
+/*
+    Zero-copy sensor worker: one copy (kernel -> segment) for the whole pipeline.
+
+    sensor_worker copies every byte source buffer -> stream_buffer -> chunk -> parser -> measurement.
+    Here:
+    - read_bytes() writes straight into the free tail of the current rx_segment
+    - the frame_scanner finds the frames in place
+    - every frame is pushed as a view_measurement holding a frame_view (segment, offset, length)
+    - the consumer reads the payload through the view and releases it by destroying it,
+      a segment is recycled once the worker moved on and all its views are gone
+
+    When the free tail of the segment is smaller than one max size frame the worker switches to a new
+    segment, the unfinished frame at the end (< max_frame_size bytes) is carried over with a memcpy.
+    That is the only copy, and it happens once per segment, not per frame.
+
+    Backpressure / overload:
+    - FULL: parsing halts at that frame, like sensor_worker. The frame and the ones after it are still in the
+      segment, the worker stops reading and waits on the queue space notifier (queue_space_notifier.h)
+      until the consumer drained the queue to the low-water mark, then pushes them in order.
+      The source buffers in the kernel meanwhile. Every FULL is counted (get_queue_full_failures()).
+    - no free segment (consumers hold every segment): the worker stops reading and retries after a short sleep,
+      the source buffers in the kernel meanwhile. Each such episode is counted (get_segment_exhaustions()).
+
+    Same start() / stop() rules as sensor_worker (thread per worker).
+*/
+
+struct view_measurement {
+    frame_view view;
+    std::chrono::steady_clock::time_point system_timestamp{};
+    size_t sensor_id = 0;
+    size_t sequence_number = 0;
+};
+
+template <typename Q>
+concept view_measurement_queue = global_queue_backend<Q> && std::same_as<typename Q::value_type, view_measurement>;
+
+template <view_measurement_queue Queue>
+class zero_copy_worker
+{
+private:
+    static constexpr std::chrono::microseconds exhausted_sleep{100};
+    static constexpr int space_poll_ms = 10; //stop requests are seen at least this often while waiting for queue space
+    static constexpr size_t no_space_slot = static_cast<size_t>(-1);
+
+    size_t sensor_id;
+    sensor_source &s_source;
+    frame_scanner &scanner;
+    segment_pool &pool;
+    Queue &global_q;
+    std::atomic<bool> stop_req;
+    bool started;
+    size_t read_errors;
+    size_t eos_count;
+    size_t queue_full_failures;
+    size_t segment_exhaustions;
+    size_t carried_bytes;
+    rx_segment *current;
+    size_t parse_pos; //start of the bytes in current not consumed by the scanner yet
+    std::vector<frame_scanner::frame_span> spans; //frames of the last scan, relative to parse_pos
+    size_t next_span; //first span not pushed yet (FULL halted the scan there)
+    size_t scan_consumed; //bytes the last scan finished with, parse_pos moves past them once every span is pushed
+    std::chrono::steady_clock::time_point scan_time;
+    size_t space_slot; //waiter slot in the queue's space notifier, taken on the first FULL
+    std::thread worker_thread;
+
+    // nullptr only when stop was requested while waiting for a free segment
+    rx_segment* acquire_segment() {
+        bool counted = false;
+        while (true) {
+            rx_segment *seg = pool.acquire();
+            if (seg != nullptr) {
+                return seg;
+            }
+            if (!counted) {
+                segment_exhaustions++;
+                counted = true;
+            }
+            if (stop_req.load()) {
+                return nullptr;
+            }
+            std::this_thread::sleep_for(exhausted_sleep);
+        }
+    }
+
+    // moves the unconsumed tail of current to the start of a fresh segment
+    bool rotate() {
+        rx_segment *next = acquire_segment();
+        if (next == nullptr) {
+            return false;
+        }
+        size_t carry = current->used - parse_pos;
+        std::memcpy(next->data, current->data + parse_pos, carry);
+        next->used = carry;
+        carried_bytes += carry;
+        pool.release(current);
+        current = next;
+        parse_pos = 0;
+        return true;
+    }
+
+    // pushes spans from next_span on, false when FULL halted it (next_span is the halted frame)
+    bool publish() {
+        while (next_span < spans.size()) {
+            const auto &span = spans[next_span];
+            view_measurement vm;
+            vm.view = frame_view(current, parse_pos + span.offset, span.length);
+            vm.system_timestamp = scan_time;
+            vm.sensor_id = sensor_id;
+
+            queue_status q_status = global_q.push(std::move(vm));
+            if (q_status == queue_status::FULL) {
+                queue_full_failures++;
+                return false;
+            }
+            if (q_status == queue_status::SHUTDOWN) {
+                eos_count++;
+            }
+            next_span++;
+        }
+        parse_pos += scan_consumed;
+        spans.clear();
+        next_span = 0;
+        scan_consumed = 0;
+        return true;
+    }
+
+    /*
+        After FULL: waits until the queue drained to the low-water mark (or stop was requested).
+        Same arm / re-check / poll / disarm protocol as sensor_worker, the poll has a timeout because
+        the stop request goes to the source, not to this fd. Without a waiter slot it sleeps and retries.
+    */
+    void wait_for_space() {
+        queue_space_notifier &notifier = global_q.space_notifier();
+        if (space_slot == no_space_slot) {
+            try {
+                space_slot = notifier.register_waiter();
+            }
+            catch (const std::exception&) {
+                std::this_thread::sleep_for(exhausted_sleep);
+                return;
+            }
+        }
+        while (!stop_req.load()) {
+            notifier.arm(space_slot);
+            size_t occupancy = global_q.size();
+            if (occupancy < global_q.capacity() && occupancy <= notifier.low_water_mark()) {
+                notifier.disarm(space_slot);
+                return;
+            }
+            pollfd plfd{notifier.fd(space_slot), POLLIN, 0};
+            int rc = poll(&plfd, 1, space_poll_ms);
+            notifier.disarm(space_slot);
+            if (rc > 0) {
+                return;
+            }
+        }
+    }
+
+    void run() {
+        current = acquire_segment();
+        if (current == nullptr) {
+            return;
+        }
+        parse_pos = 0;
+
+        while (!stop_req.load()) {
+            //frames halted by FULL go first, nothing is read until they are in the queue
+            if (next_span < spans.size()) {
+                wait_for_space();
+                publish();
+                continue;
+            }
+
+            if (current->capacity - current->used < scanner.max_frame_size() && !rotate()) {
+                break;
+            }
+
+            ssize_t num_of_bytes_from_sensor = s_source.read_bytes(current->data + current->used, current->capacity - current->used);
+
+            if (num_of_bytes_from_sensor == 0) {
+                eos_count++;
+                break;
+            }
+
+            if (num_of_bytes_from_sensor < 0) {
+                read_errors++;
+                continue;
+            }
+
+            current->used += static_cast<size_t>(num_of_bytes_from_sensor);
+
+            spans.clear();
+            next_span = 0;
+            scan_consumed = scanner.scan(current->data + parse_pos, current->used - parse_pos, spans);
+            scan_time = std::chrono::steady_clock::now();
+            publish();
+        }
+
+        //frames still halted by FULL are dropped on stop
+        spans.clear();
+        next_span = 0;
+        pool.release(current);
+        current = nullptr;
+    }
+
+public:
+    // the pool segments must hold at least two max size frames
+    zero_copy_worker(size_t sensorid, sensor_source &sen_s, frame_scanner &f_scanner, segment_pool &seg_pool, Queue &g_q) : sensor_id(sensorid), s_source(sen_s), scanner(f_scanner), pool(seg_pool), global_q(g_q), stop_req(false), started(false), read_errors(0), eos_count(0), queue_full_failures(0), segment_exhaustions(0), carried_bytes(0), current(nullptr), parse_pos(0), next_span(0), scan_consumed(0), space_slot(no_space_slot) {
+        if (pool.segment_size() < 2 * scanner.max_frame_size()) {
+            throw std::invalid_argument("segment size too small for the frame format");
+        }
+    }
+
+    ~zero_copy_worker() {
+        stop();
+        if (space_slot != no_space_slot) {
+            global_q.space_notifier().release_waiter(space_slot);
+        }
+    }
+
+    zero_copy_worker(const zero_copy_worker&) = delete;
+    zero_copy_worker& operator=(const zero_copy_worker&) = delete;
+
+    // start() may be called only once per object lifetime, from a single control thread
+    bool start() {
+        if (started) {
+            return false;
+        }
+        started = true;
+        stop_req = false;
+        worker_thread = std::thread(&zero_copy_worker::run, this);
+        return true;
+    }
+
+    void stop() {
+        if (stop_req.exchange(true) || !started) {
+            return;
+        }
+        s_source.stop_request();
+        if (worker_thread.joinable()) {
+            worker_thread.join();
+        }
+        started = false;
+    }
+
+    size_t get_sensor_id() const { return sensor_id; }
+    size_t get_read_errors_count() const { return read_errors; }
+    size_t get_eos_count() const { return eos_count; }
+
+    // pushes that got FULL, each one halted parsing until the queue had space again
+    size_t get_queue_full_failures() const { return queue_full_failures; }
+
+    // times the worker had to wait because every segment was still referenced
+    size_t get_segment_exhaustions() const { return segment_exhaustions; }
+
+    // bytes copied when switching segments (unfinished frames carried over)
+    size_t get_carried_bytes() const { return carried_bytes; }
+};
+
+#endif